@@ -0,0 +1,121 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include <learnopengl/geometry_arena.h>
+#include <learnopengl/material_table.h>
+#include <learnopengl/model.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/thread_pool.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef unsigned int ModelHandle;
+
+// Loads models and textures without blocking the render loop. Load calls return a handle immediately,
+// imports and image decodes run on the worker pool and Update() (called once per frame) uploads the finished
+// work to the GPU, at most uploadBudget bytes per frame. Textures show a placeholder until their image arrives,
+// models simply have no meshes until their geometry is uploaded.
+class AssetManager
+{
+public:
+    explicit AssetManager(size_t uploadBudget = 16 * 1024 * 1024)
+        : uploadBudget(uploadBudget) {}
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    // meshFlags (MESH_KEEP_CPU_DATA, MESH_PACKED_VERTICES, MESH_MATERIAL_TABLE) apply to every mesh of the model.
+    ModelHandle LoadModel(const std::string &path, const std::string &textureNamePrefix = "", bool gamma = false,
+                          unsigned int meshFlags = 0)
+    {
+        ModelSlot slot;
+        slot.model.reset(new Model(path, gamma, Model::DeferredLoad()));
+        slot.model->meshFlags = meshFlags;
+        slot.model->SetShaderTextureNamePrefix(textureNamePrefix);
+        slot.import = ThreadPool::Workers().Submit([path] {
+            std::vector<MeshData> meshes;
+            Model::ReadModel(path, meshes);
+            return meshes;
+        });
+        models.push_back(std::move(slot));
+        return models.size() - 1;
+    }
+
+    unsigned int LoadCubemap(const std::vector<std::string> &faces)
+    {
+        return TextureRegistry::Instance().Loader().LoadCubemap(faces);
+    }
+
+    Model& GetModel(ModelHandle handle) { return *models[handle].model; }
+
+    // true once all meshes of the model are on the GPU (its textures may still be placeholders)
+    bool IsReady(ModelHandle handle) const { return models[handle].state == Resident; }
+
+    bool Idle() const
+    {
+        for (const ModelSlot &slot : models)
+            if (slot.state != Resident)
+                return false;
+        return TextureRegistry::Instance().Loader().Idle();
+    }
+
+    void Update()
+    {
+        size_t uploaded = 0;
+        for (ModelSlot &slot : models)
+        {
+            if (slot.state == Importing && slot.import.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                slot.meshes = slot.import.get();
+                slot.state = Uploading;
+            }
+            while (slot.state == Uploading && uploaded < uploadBudget)
+            {
+                if (slot.nextMesh == slot.meshes.size())
+                {
+                    slot.meshes.clear();
+                    slot.meshes.shrink_to_fit();
+                    slot.state = Resident;
+                    break;
+                }
+                MeshData &mesh = slot.meshes[slot.nextMesh++];
+                // packed meshes upload PackedVertex, not the Vertex they were imported as
+                VertexFormat format = slot.model->meshFlags & MESH_PACKED_VERTICES
+                                      ? VERTEX_FORMAT_PACKED : VERTEX_FORMAT_FLOAT;
+                uploaded += mesh.vertices.size() * GeometryArena::VertexSize(format)
+                            + mesh.indices.size() * sizeof(unsigned int);
+                slot.model->AddMesh(std::move(mesh));
+            }
+        }
+        if (uploaded < uploadBudget)
+            TextureRegistry::Instance().Loader().Update(uploadBudget - uploaded);
+        MaterialTable::Instance().Update();
+    }
+
+    // unloads every model, has to happen while the GL context is still alive.
+    void Clear()
+    {
+        models.clear();
+    }
+
+private:
+    enum SlotState { Importing, Uploading, Resident };
+
+    struct ModelSlot {
+        std::unique_ptr<Model> model;
+        std::future<std::vector<MeshData>> import;
+        std::vector<MeshData> meshes;
+        unsigned int nextMesh = 0;
+        SlotState state = Importing;
+    };
+
+    std::vector<ModelSlot> models;
+    size_t uploadBudget;
+};
+
+#endif
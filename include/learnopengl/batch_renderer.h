@@ -0,0 +1,228 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/material_table.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <vector>
+
+// texture unit of the model matrix buffer, well above the material textures
+const unsigned int MODEL_MATRIX_TEXTURE_UNIT = 15;
+
+// Collects the meshes drawn in a pass and draws them with as few calls as possible. Draws are sorted by vertex
+// array, material and mesh, every mesh is drawn once with glDrawElementsInstancedBaseVertex for all the objects
+// that use it, and each instance reads its model matrix from a texture buffer ("modelMatrices", offset by
+// "instanceOffset"). Adding more copies of a model adds instances, not draw calls.
+// MaterialTable meshes are sorted by the texture arrays they sample, between them a draw only sets "materialID".
+// Meshes with levels of detail are batched per level, each level of a mesh is its own instanced draw.
+class BatchRenderer
+{
+public:
+    BatchRenderer()
+    {
+        glGenBuffers(1, &matrixBuffer);
+        glGenTextures(1, &matrixTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, matrixBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, matrixTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, matrixBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    BatchRenderer(const BatchRenderer&) = delete;
+    BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+    void Submit(const Model &model, const glm::mat4 &transform)
+    {
+        unsigned int matrix = AddTransform(transform);
+        for (const Mesh &mesh : model.meshes)
+            SubmitMesh(mesh, matrix);
+    }
+
+    // for submitting meshes one by one (e.g. the ones that survived culling), several meshes can share a matrix
+    unsigned int AddTransform(const glm::mat4 &transform)
+    {
+        transforms.push_back(transform);
+        return transforms.size() - 1;
+    }
+
+    // lod picks the mesh's level of detail, clamped to the levels it has
+    void SubmitMesh(const Mesh &mesh, unsigned int matrix, unsigned int lod = 0)
+    {
+        draws.push_back({&mesh, std::min(lod, mesh.LodCount() - 1), matrix});
+    }
+
+    // draws everything submitted since the last Flush with the (already active) shader
+    void Flush(Shader &shader)
+    {
+        if (draws.empty())
+        {
+            transforms.clear();
+            return;
+        }
+        std::sort(draws.begin(), draws.end(), drawOrder);
+
+        // matrices in draw order, so the instances of a mesh are consecutive
+        sortedTransforms.clear();
+        for (const Draw &draw : draws)
+            sortedTransforms.push_back(transforms[draw.matrix]);
+        uploadTransforms();
+
+        glActiveTexture(GL_TEXTURE0 + MODEL_MATRIX_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, matrixTexture);
+        shader.setInt("modelMatrices", MODEL_MATRIX_TEXTURE_UNIT);
+        GLint instanceOffset = shader.Location("instanceOffset");
+        GLint materialID = shader.Location("materialID");
+        const MaterialTable &table = MaterialTable::Instance();
+
+        unsigned int boundVAO = 0;
+        const Mesh *boundMaterial = nullptr;
+        // arrays on units 0 and 1, ~0u until the first MaterialTable mesh
+        unsigned int boundDiffuse = ~0u, boundSpecular = ~0u;
+        drawCalls = 0;
+        for (size_t first = 0; first < draws.size();)
+        {
+            const Mesh &mesh = *draws[first].mesh;
+            unsigned int lod = draws[first].lod;
+            size_t last = first + 1;
+            while (last < draws.size() && draws[last].mesh == &mesh && draws[last].lod == lod)
+                last++;
+
+            if (mesh.VAO != boundVAO)
+            {
+                glBindVertexArray(mesh.VAO);
+                boundVAO = mesh.VAO;
+            }
+            if (mesh.materialID >= 0)
+            {
+                unsigned int diffuse = table.DiffuseArray(mesh.materialID);
+                unsigned int specular = table.SpecularArray(mesh.materialID);
+                if (diffuse != boundDiffuse)
+                {
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D_ARRAY, diffuse);
+                    boundDiffuse = diffuse;
+                }
+                if (specular != boundSpecular)
+                {
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D_ARRAY, specular);
+                    boundSpecular = specular;
+                }
+                shader.setInt(materialID, mesh.materialID);
+            }
+            else if (!boundMaterial || !sameMaterial(*boundMaterial, mesh))
+            {
+                mesh.BindTextures(shader);
+                boundMaterial = &mesh;
+            }
+            mesh.SetVertexDecode(shader);
+            shader.setInt(instanceOffset, (int)first);
+            const MeshLod &range = mesh.Lod(lod);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, Mesh::IndexOffset(range),
+                                              last - first, mesh.baseVertex);
+            drawCalls++;
+            first = last;
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+
+        draws.clear();
+        transforms.clear();
+    }
+
+    // number of draw calls issued by the last Flush
+    unsigned int DrawCalls() const { return drawCalls; }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        glDeleteTextures(1, &matrixTexture);
+        glDeleteBuffers(1, &matrixBuffer);
+        matrixTexture = matrixBuffer = 0;
+    }
+
+private:
+    struct Draw {
+        const Mesh *mesh;
+        unsigned int lod;
+        unsigned int matrix;
+    };
+
+    unsigned int matrixBuffer = 0;
+    unsigned int matrixTexture = 0;
+    size_t matrixCapacity = 0;
+    unsigned int drawCalls = 0;
+    std::vector<Draw> draws;
+    std::vector<glm::mat4> transforms;
+    std::vector<glm::mat4> sortedTransforms;
+
+    static bool sameMaterial(const Mesh &a, const Mesh &b)
+    {
+        if (a.textures.size() != b.textures.size() || a.glslIdentifierPrefix != b.glslIdentifierPrefix)
+            return false;
+        for (size_t i = 0; i < a.textures.size(); i++)
+            if (a.textures[i].id != b.textures[i].id || a.textures[i].type != b.textures[i].type)
+                return false;
+        return true;
+    }
+
+    static bool materialLess(const Mesh &a, const Mesh &b)
+    {
+        if ((a.materialID >= 0) != (b.materialID >= 0))
+            return a.materialID < b.materialID;
+        if (a.materialID >= 0)
+        {
+            const MaterialTable &table = MaterialTable::Instance();
+            unsigned int diffuseA = table.DiffuseArray(a.materialID), diffuseB = table.DiffuseArray(b.materialID);
+            if (diffuseA != diffuseB)
+                return diffuseA < diffuseB;
+            unsigned int specularA = table.SpecularArray(a.materialID), specularB = table.SpecularArray(b.materialID);
+            if (specularA != specularB)
+                return specularA < specularB;
+            return a.materialID < b.materialID;
+        }
+        size_t count = std::min(a.textures.size(), b.textures.size());
+        for (size_t i = 0; i < count; i++)
+            if (a.textures[i].id != b.textures[i].id)
+                return a.textures[i].id < b.textures[i].id;
+        return a.textures.size() < b.textures.size();
+    }
+
+    static bool drawOrder(const Draw &a, const Draw &b)
+    {
+        if (a.mesh->VAO != b.mesh->VAO)
+            return a.mesh->VAO < b.mesh->VAO;
+        if (a.mesh != b.mesh)
+        {
+            if (materialLess(*a.mesh, *b.mesh))
+                return true;
+            if (materialLess(*b.mesh, *a.mesh))
+                return false;
+            return a.mesh < b.mesh;
+        }
+        if (a.lod != b.lod)
+            return a.lod < b.lod;
+        return a.matrix < b.matrix;
+    }
+
+    void uploadTransforms()
+    {
+        size_t size = sortedTransforms.size() * sizeof(glm::mat4);
+        glBindBuffer(GL_TEXTURE_BUFFER, matrixBuffer);
+        if (size > matrixCapacity)
+            matrixCapacity = std::max(size, matrixCapacity * 2);
+        // fresh storage every frame, so we never wait for the previous frame's draws to finish reading it
+        glBufferData(GL_TEXTURE_BUFFER, matrixCapacity, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, sortedTransforms.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// Bloom over a mip chain (Jimenez, "Next Generation Post Processing in Call of Duty: Advanced Warfare"): the bright
+// parts of the image are downsampled level by level with a 13 tap filter, then upsampled back with a 3x3 tent
+// filter, each level added onto the one above. The blur gets wider with every level while every pass touches a
+// quarter of the pixels of the one before, so all of it costs less than a single full resolution blur pass.
+// The first downsample weights its taps by 1 / (1 + luma) (Karis average) so single very bright pixels don't
+// flicker. The result is half the resolution of the source and holds the sum of all the levels.
+class MipChainBloom
+{
+public:
+    // width and height of the images it blurs
+    MipChainBloom(unsigned int width, unsigned int height, unsigned int mipCount = 6)
+        : downsampleShader("resources/shaders/bloom.vs", "resources/shaders/bloomDownsample.fs"),
+          upsampleShader("resources/shaders/bloom.vs", "resources/shaders/bloomUpsample.fs"),
+          mipCount(mipCount)
+    {
+        glGenFramebuffers(1, &framebuffer);
+        allocate(width, height);
+
+        // the passes draw a full screen triangle from gl_VertexID, the VAO stays empty
+        glGenVertexArrays(1, &VAO);
+        downsampleShader.use();
+        downsampleShader.setInt("source", 0);
+        upsampleShader.use();
+        upsampleShader.setInt("source", 0);
+        glUseProgram(0);
+    }
+
+    MipChainBloom(const MipChainBloom&) = delete;
+    MipChainBloom& operator=(const MipChainBloom&) = delete;
+
+    // blurs source (the bright parts of the image) into Texture(). Keeps the viewport and blending as they were,
+    // leaves the default framebuffer bound.
+    void Render(unsigned int source)
+    {
+        GLint viewport[4], blendSource, blendDestination;
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource);
+        glGetIntegerv(GL_BLEND_DST_RGB, &blendDestination);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glBindVertexArray(VAO);
+        glActiveTexture(GL_TEXTURE0);
+
+        glDisable(GL_BLEND);
+        downsampleShader.use();
+        for (unsigned int i = 0; i < mips.size(); i++)
+        {
+            downsampleShader.setBool("karisAverage", i == 0);
+            glBindTexture(GL_TEXTURE_2D, i == 0 ? source : mips[i - 1].texture);
+            drawInto(mips[i]);
+        }
+
+        // every level adds its upsampled blur onto the level above
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        upsampleShader.use();
+        for (unsigned int i = mips.size() - 1; i > 0; i--)
+        {
+            glBindTexture(GL_TEXTURE_2D, mips[i].texture);
+            drawInto(mips[i - 1]);
+        }
+        glBlendFunc(blendSource, blendDestination);
+        if (!blend)
+            glDisable(GL_BLEND);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindVertexArray(0);
+        glUseProgram(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // reallocates the chain for images of a new size, does nothing if the size didn't change
+    void Resize(unsigned int width, unsigned int height)
+    {
+        if (width == sourceSize.x && height == sourceSize.y)
+            return;
+        deleteMips();
+        allocate(width, height);
+    }
+
+    unsigned int Texture() const { return mips[0].texture; }
+    // the result is the sum of this many blurs of the source
+    unsigned int MipCount() const { return mips.size(); }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        deleteMips();
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteProgram(downsampleShader.ID);
+        glDeleteProgram(upsampleShader.ID);
+        framebuffer = VAO = 0;
+    }
+
+private:
+    struct Mip {
+        glm::ivec2 size;
+        unsigned int texture;
+    };
+
+    Shader downsampleShader;
+    Shader upsampleShader;
+    unsigned int mipCount;
+    std::vector<Mip> mips;
+    glm::uvec2 sourceSize = glm::uvec2(0);
+    unsigned int framebuffer = 0;
+    unsigned int VAO = 0;
+
+    void allocate(unsigned int width, unsigned int height)
+    {
+        sourceSize = glm::uvec2(width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        unsigned int mipWidth = width, mipHeight = height;
+        for (unsigned int i = 0; i < mipCount && (mipWidth > 1 || mipHeight > 1); i++)
+        {
+            mipWidth = std::max(mipWidth / 2, 1u);
+            mipHeight = std::max(mipHeight / 2, 1u);
+            Mip mip;
+            mip.size = glm::ivec2(mipWidth, mipHeight);
+            glGenTextures(1, &mip.texture);
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+            // no alpha and a third of the bandwidth of RGBA16F, plenty for light that's only added on top
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, mipWidth, mipHeight, 0, GL_RGB, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            mips.push_back(mip);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mips[0].texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Bloom framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void deleteMips()
+    {
+        for (Mip &mip : mips)
+            glDeleteTextures(1, &mip.texture);
+        mips.clear();
+    }
+
+    void drawInto(const Mip &mip)
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mip.texture, 0);
+        glViewport(0, 0, mip.size.x, mip.size.y);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+};
+
+#endif
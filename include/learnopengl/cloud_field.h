@@ -0,0 +1,225 @@
+#ifndef CLOUD_FIELD_H
+#define CLOUD_FIELD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum.h>
+#include <learnopengl/random.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+// one cloud, 32 bytes instead of a mat4: xyz position and uniform scale, rotation quaternion as (x, y, z, w)
+struct CloudInstance {
+    glm::vec4 positionScale;
+    glm::vec4 rotation;
+};
+
+// consecutive instances in the field's instance buffer
+struct InstanceRange {
+    GLint first;
+    GLsizei count;
+};
+
+// An endless field of clouds around the camera. The XZ plane is split into square chunks of a fixed number of
+// clouds; Update() generates the chunks within radius chunks of the camera, nearest first and at most a few per
+// frame, and drops the ones the camera left behind.
+// Every cloud is a pure function of the seed, its chunk and its index (see GenerateClouds), so the same seed always
+// gives the same field, a chunk that comes back looks the same and chunks are generated on the worker pool.
+// Resident chunks live in fixed slots of one instance buffer sized for the chunks around the camera (plus the
+// ring of chunks kept while they're still close), so memory and per frame uploads stay the same however far the
+// camera travels.
+class CloudField
+{
+public:
+    explicit CloudField(uint64_t seed, float chunkSize = 32.0f, unsigned int instancesPerChunk = 1024, int radius = 4)
+        : seed(seed), chunkSize(chunkSize), instancesPerChunk(instancesPerChunk), radius(radius)
+    {
+        unsigned int side = 2 * (radius + 1) + 1;
+        slotCount = side * side;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, Capacity() * sizeof(CloudInstance), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        for (unsigned int slot = slotCount; slot-- > 0;)
+            freeSlots.push_back(slot);
+    }
+
+    CloudField(const CloudField&) = delete;
+    CloudField& operator=(const CloudField&) = delete;
+
+    // uploads the chunks whose generation finished and queues the missing ones around the camera, never more than
+    // chunkBudget in flight. Doesn't block.
+    void Update(const glm::vec3 &cameraPosition, unsigned int chunkBudget = 16)
+    {
+        int centerX = (int)std::floor(cameraPosition.x / chunkSize);
+        int centerZ = (int)std::floor(cameraPosition.z / chunkSize);
+
+        // evict what's more than a ring outside the radius, so walking along a chunk border doesn't regenerate
+        for (auto it = chunks.begin(); it != chunks.end();)
+        {
+            if (outside(it->second, centerX, centerZ))
+            {
+                freeSlots.push_back(it->second.slot);
+                it = chunks.erase(it);
+            }
+            else
+                ++it;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (unsigned int i = 0; i < pending.size();)
+        {
+            PendingChunk &job = pending[i];
+            if (job.instances.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                i++;
+                continue;
+            }
+            std::vector<CloudInstance> instances = job.instances.get();
+            Chunk chunk = job.chunk;
+            if (!outside(chunk, centerX, centerZ) && !freeSlots.empty())
+            {
+                chunk.slot = freeSlots.back();
+                freeSlots.pop_back();
+                glBufferSubData(GL_ARRAY_BUFFER, chunk.slot * instancesPerChunk * sizeof(CloudInstance),
+                                instancesPerChunk * sizeof(CloudInstance), instances.data());
+                chunks[key(chunk.x, chunk.z)] = chunk;
+            }
+            pending.erase(pending.begin() + i);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        missing.clear();
+        for (int z = centerZ - radius; z <= centerZ + radius; z++)
+            for (int x = centerX - radius; x <= centerX + radius; x++)
+                if (chunks.find(key(x, z)) == chunks.end() && !isPending(x, z))
+                    missing.push_back({x, z, 0});
+        std::sort(missing.begin(), missing.end(), [centerX, centerZ](const Chunk &a, const Chunk &b) {
+            return (a.x - centerX) * (a.x - centerX) + (a.z - centerZ) * (a.z - centerZ) <
+                   (b.x - centerX) * (b.x - centerX) + (b.z - centerZ) * (b.z - centerZ);
+        });
+
+        for (unsigned int i = 0; i < missing.size() && pending.size() < chunkBudget; i++)
+        {
+            const Chunk &chunk = missing[i];
+            // the job only captures values, it can outlive the field
+            uint64_t seed = this->seed;
+            float chunkSize = this->chunkSize;
+            unsigned int count = instancesPerChunk;
+            int x = chunk.x, z = chunk.z;
+            pending.push_back({chunk, ThreadPool::Workers().Submit([=] {
+                std::vector<CloudInstance> instances(count);
+                GenerateClouds(seed, x, z, chunkSize, 0, count, instances.data());
+                return instances;
+            })});
+        }
+    }
+
+    // writes clouds first..first+count of a chunk. Every cloud only depends on (seed, chunk, index), so a chunk can
+    // be split over any number of threads and still come out the same.
+    static void GenerateClouds(uint64_t seed, int chunkX, int chunkZ, float chunkSize, unsigned int first,
+                               unsigned int count, CloudInstance *instances)
+    {
+        const glm::vec3 axis = glm::normalize(glm::vec3(0.4f, 0.6f, 0.8f));
+        for (unsigned int i = 0; i < count; i++)
+        {
+            unsigned int index = first + i;
+            // one block of four numbers per cloud, height and scale share the third one (16 bits each is plenty)
+            Philox4x32 random(index, (uint32_t)chunkX, (uint32_t)chunkZ, 0, seed);
+            float height = (random.v[2] >> 16) * (1.0f / 65536.0f);
+            float size = (random.v[2] & 0xFFFFu) * (1.0f / 65536.0f);
+
+            glm::vec3 position((chunkX + random.Unit(0)) * chunkSize, 0.0f, (chunkZ + random.Unit(1)) * chunkSize);
+            // half of them above the island, half below
+            position.y = index % 2 == 0 ? 6.0f + 10.0f * height : -4.0f - 10.0f * height;
+            float scale = MIN_SCALE + (MAX_SCALE - MIN_SCALE) * size;
+            // rotation around the fixed axis, as a quaternion
+            float halfAngle = random.Unit(3) * 3.14159265f;
+            float sine = std::sin(halfAngle);
+            instances[i].positionScale = glm::vec4(position, scale);
+            instances[i].rotation = glm::vec4(axis * sine, std::cos(halfAngle));
+        }
+    }
+
+    // the resident chunks whose bounds touch the frustum, sphere is the object space bounding sphere of the cloud
+    // model (center, radius) so the chunk bounds can be grown by what a cloud sticks out of its chunk
+    void VisibleRanges(const Frustum &frustum, const glm::vec4 &sphere, std::vector<InstanceRange> &ranges) const
+    {
+        ranges.clear();
+        float cloudRadius = (glm::length(glm::vec3(sphere)) + sphere.w) * MAX_SCALE;
+        float halfSize = chunkSize * 0.5f;
+        glm::vec3 extents(halfSize + cloudRadius, (MAX_HEIGHT - MIN_HEIGHT) * 0.5f + cloudRadius, halfSize + cloudRadius);
+        for (const auto &entry : chunks)
+        {
+            const Chunk &chunk = entry.second;
+            glm::vec3 center((chunk.x + 0.5f) * chunkSize, (MIN_HEIGHT + MAX_HEIGHT) * 0.5f, (chunk.z + 0.5f) * chunkSize);
+            if (frustum.IntersectsBox(center, extents))
+                ranges.push_back({(GLint)(chunk.slot * instancesPerChunk), (GLsizei)instancesPerChunk});
+        }
+    }
+
+    unsigned int InstanceBuffer() const { return buffer; }
+    // instances the buffer has room for
+    unsigned int Capacity() const { return slotCount * instancesPerChunk; }
+    unsigned int ResidentInstances() const { return chunks.size() * instancesPerChunk; }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+private:
+    // clouds float in two layers, one above and one below the island
+    static constexpr float MIN_HEIGHT = -14.0f;
+    static constexpr float MAX_HEIGHT = 16.0f;
+    static constexpr float MIN_SCALE = 0.1f;
+    static constexpr float MAX_SCALE = 0.3f;
+
+    struct Chunk {
+        int x, z;
+        unsigned int slot;
+    };
+    struct PendingChunk {
+        Chunk chunk;
+        std::future<std::vector<CloudInstance>> instances;
+    };
+
+    uint64_t seed;
+    float chunkSize;
+    unsigned int instancesPerChunk;
+    int radius;
+    unsigned int slotCount;
+    unsigned int buffer = 0;
+    std::unordered_map<int64_t, Chunk> chunks;
+    std::vector<unsigned int> freeSlots;
+    std::vector<PendingChunk> pending;
+    std::vector<Chunk> missing;
+
+    static int64_t key(int x, int z) { return ((int64_t)x << 32) | (uint32_t)z; }
+
+    bool outside(const Chunk &chunk, int centerX, int centerZ) const
+    {
+        return std::abs(chunk.x - centerX) > radius + 1 || std::abs(chunk.z - centerZ) > radius + 1;
+    }
+
+    bool isPending(int x, int z) const
+    {
+        for (const PendingChunk &job : pending)
+            if (job.chunk.x == x && job.chunk.z == z)
+                return true;
+        return false;
+    }
+};
+
+#endif
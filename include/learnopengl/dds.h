@@ -0,0 +1,143 @@
+#ifndef DDS_H
+#define DDS_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Minimal DDS container support for the block compressed textures written by texture_baker (tools/).
+// Only what we bake is understood: a single 2D image with a full mip chain in BC1 (DXT1), BC3 (DXT5) or
+// BC5 (ATI2), stored level after level right behind the header.
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+const uint32_t DDSD_CAPS = 0x1;
+const uint32_t DDSD_HEIGHT = 0x2;
+const uint32_t DDSD_WIDTH = 0x4;
+const uint32_t DDSD_PIXELFORMAT = 0x1000;
+const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+const uint32_t DDSD_LINEARSIZE = 0x80000;
+const uint32_t DDPF_FOURCC = 0x4;
+const uint32_t DDSCAPS_COMPLEX = 0x8;
+const uint32_t DDSCAPS_TEXTURE = 0x1000;
+const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+enum DDSFormat {
+    DDS_UNKNOWN,
+    DDS_BC1,    // RGB, 4 bits per pixel
+    DDS_BC3,    // RGBA, 8 bits per pixel
+    DDS_BC5     // two channels, 8 bits per pixel. Recognized but neither baked nor loaded, nothing samples it
+};
+
+struct DDSPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DDSHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+inline uint32_t DDSFourCC(char a, char b, char c, char d)
+{
+    return (uint32_t)(unsigned char)a | ((uint32_t)(unsigned char)b << 8)
+           | ((uint32_t)(unsigned char)c << 16) | ((uint32_t)(unsigned char)d << 24);
+}
+
+inline uint32_t DDSFourCCFor(DDSFormat format)
+{
+    switch (format) {
+        case DDS_BC1: return DDSFourCC('D', 'X', 'T', '1');
+        case DDS_BC3: return DDSFourCC('D', 'X', 'T', '5');
+        case DDS_BC5: return DDSFourCC('A', 'T', 'I', '2');
+        default: return 0;
+    }
+}
+
+inline uint32_t DDSBlockBytes(DDSFormat format)
+{
+    return format == DDS_BC1 ? 8 : 16;
+}
+
+// size in bytes of one mip level, blocks always cover 4x4 pixels even for the tiny levels
+inline size_t DDSLevelSize(DDSFormat format, uint32_t width, uint32_t height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * DDSBlockBytes(format);
+}
+
+// number of levels in a full mip chain down to 1x1
+inline uint32_t DDSFullMipCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    while (width > 1 || height > 1)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+// the baked version of a source image lives next to it, e.g. island_diffuse.png.dds
+inline std::string BakedTexturePath(const std::string &sourcePath)
+{
+    return sourcePath + ".dds";
+}
+
+// validates an in memory DDS file, returns the format, size and where the first level starts.
+inline bool ParseDDS(const unsigned char *data, size_t size, DDSFormat &format, uint32_t &width, uint32_t &height,
+                     uint32_t &mipCount, size_t &dataOffset)
+{
+    uint32_t magic;
+    DDSHeader header;
+    if (size < sizeof(magic) + sizeof(header))
+        return false;
+    memcpy(&magic, data, sizeof(magic));
+    memcpy(&header, data + sizeof(magic), sizeof(header));
+    if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPF_FOURCC))
+        return false;
+
+    format = DDS_UNKNOWN;
+    const DDSFormat known[] = {DDS_BC1, DDS_BC3, DDS_BC5};
+    for (DDSFormat candidate : known)
+        if (header.pixelFormat.fourCC == DDSFourCCFor(candidate))
+            format = candidate;
+    if (format == DDS_UNKNOWN || header.width == 0 || header.height == 0)
+        return false;
+
+    width = header.width;
+    height = header.height;
+    mipCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount ? header.mipMapCount : 1;
+    dataOffset = sizeof(magic) + sizeof(header);
+
+    // make sure every level is actually in the file
+    size_t end = dataOffset;
+    uint32_t w = width, h = height;
+    for (uint32_t level = 0; level < mipCount; level++)
+    {
+        end += DDSLevelSize(format, w, h);
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    return end <= size;
+}
+
+#endif
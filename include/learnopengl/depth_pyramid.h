@@ -0,0 +1,145 @@
+#ifndef DEPTH_PYRAMID_H
+#define DEPTH_PYRAMID_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <vector>
+
+// texture unit the culling passes sample the pyramid from, next to the model matrices
+const unsigned int DEPTH_PYRAMID_TEXTURE_UNIT = 14;
+
+// Hierarchical Z buffer for occlusion culling: a mip chain of the depth buffer where every texel holds the farthest
+// depth of the texels it covers. Level 0 is half the size of the depth buffer. Whatever is nearer than the
+// farthest depth under its screen rectangle may be visible, whatever is farther is certainly behind the occluders,
+// and a handful of fetches from the right level answer that for a rectangle of any size.
+// Odd sizes round down, the last texel of a row or column then also covers the one left over, so a texel never
+// misses any depth of the level below.
+class DepthPyramid
+{
+public:
+    // width and height of the depth buffer it's built from
+    DepthPyramid(unsigned int width, unsigned int height)
+        : shader("resources/shaders/depthPyramid.vs", "resources/shaders/depthPyramid.fs")
+    {
+        allocate(width, height);
+        glGenFramebuffers(1, &framebuffer);
+        // the passes draw a full screen triangle from gl_VertexID, the VAO stays empty
+        glGenVertexArrays(1, &VAO);
+        shader.use();
+        shader.setInt("source", 0);
+        glUseProgram(0);
+    }
+
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    // reduces depthTexture (a depth texture without mipmaps and with nearest filtering) drawn with viewProjection
+    // into the pyramid. Keeps the bound framebuffer, viewport, depth test and polygon mode as they were.
+    void Build(unsigned int depthTexture, const glm::mat4 &viewProjection)
+    {
+        GLint previousFramebuffer, viewport[4], polygonMode[2];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        glDisable(GL_DEPTH_TEST);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        shader.use();
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glBindVertexArray(VAO);
+        glActiveTexture(GL_TEXTURE0);
+        for (unsigned int level = 0; level < sizes.size(); level++)
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, level);
+            if (level == 0)
+                glBindTexture(GL_TEXTURE_2D, depthTexture);
+            else
+            {
+                // only the level below is visible to the shader, so reading it while writing this one isn't a
+                // feedback loop
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+            }
+            glViewport(0, 0, sizes[level].x, sizes[level].y);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, sizes.size() - 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindVertexArray(0);
+        glUseProgram(0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        this->viewProjection = viewProjection;
+    }
+
+    // reallocates the pyramid for a depth buffer of a new size, does nothing if the size didn't change
+    void Resize(unsigned int width, unsigned int height)
+    {
+        if (width == depthSize.x && height == depthSize.y)
+            return;
+        glDeleteTextures(1, &texture);
+        sizes.clear();
+        allocate(width, height);
+    }
+
+    unsigned int Texture() const { return texture; }
+    unsigned int Levels() const { return sizes.size(); }
+    // the matrix the depth buffer of the last Build was drawn with, occlusion tests have to project with it
+    const glm::mat4& ViewProjection() const { return viewProjection; }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        glDeleteTextures(1, &texture);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteProgram(shader.ID);
+        texture = framebuffer = VAO = 0;
+    }
+
+private:
+    Shader shader;
+    unsigned int texture = 0;
+    unsigned int framebuffer = 0;
+    unsigned int VAO = 0;
+    std::vector<glm::ivec2> sizes;
+    glm::uvec2 depthSize = glm::uvec2(0);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    void allocate(unsigned int width, unsigned int height)
+    {
+        depthSize = glm::uvec2(width, height);
+        unsigned int levelWidth = std::max(width / 2, 1u), levelHeight = std::max(height / 2, 1u);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        for (unsigned int level = 0;; level++)
+        {
+            sizes.push_back(glm::ivec2(levelWidth, levelHeight));
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelWidth, levelHeight, 0, GL_RED, GL_FLOAT, NULL);
+            if (levelWidth == 1 && levelHeight == 1)
+                break;
+            levelWidth = std::max(levelWidth / 2, 1u);
+            levelHeight = std::max(levelHeight / 2, 1u);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, sizes.size() - 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
+
+#endif
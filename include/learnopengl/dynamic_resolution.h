@@ -0,0 +1,136 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+
+// Picks the fraction of the window's resolution to render at so the GPU keeps up with a target frame time.
+// Begin()/End() wrap the GPU work of a frame in a GL_TIME_ELAPSED query; the results are read a few frames later,
+// when they're ready, so measuring never stalls. The cost of a frame is taken to grow with the pixel count, so the
+// scale moves by the square root of how far the averaged time is off the target.
+// The scale only changes in steps of SCALE_STEP and waits for a few fresh measurements after every change: every
+// new scale means new render targets, and the time measured at the old scale says little about the new one, so
+// results of queries issued before the change are dropped.
+// Scaling up also needs some headroom below the target, so the scale doesn't flip between two steps.
+class DynamicResolution
+{
+public:
+    static constexpr float SCALE_STEP = 0.05f;
+
+    explicit DynamicResolution(float targetMilliseconds = 16.0f, float minScale = 0.5f, float maxScale = 1.0f)
+        : targetMilliseconds(targetMilliseconds), minStep(toStep(minScale)), maxStep(toStep(maxScale)),
+          step(maxStep)
+    {
+        glGenQueries(QUERY_COUNT, queries);
+    }
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // takes in the measurements that are ready and adapts the scale, call it before reading Scale() for a frame so
+    // the frame is timed at the scale it's rendered at
+    void Update()
+    {
+        readResults();
+    }
+
+    // starts timing the frame's GPU work, unless all the queries are still in flight
+    void Begin()
+    {
+        timing = !pending[next];
+        if (timing)
+        {
+            glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+            querySteps[next] = step;
+        }
+    }
+
+    void End()
+    {
+        if (!timing)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[next] = true;
+        next = (next + 1) % QUERY_COUNT;
+        timing = false;
+    }
+
+    // fraction of the window's width and height to render at
+    float Scale() const { return step * SCALE_STEP; }
+    // averaged GPU time of the recent frames
+    float GpuMilliseconds() const { return averageMilliseconds; }
+
+    void SetTargetMilliseconds(float milliseconds) { targetMilliseconds = milliseconds; }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        glDeleteQueries(QUERY_COUNT, queries);
+    }
+
+private:
+    static const unsigned int QUERY_COUNT = 4;
+    // measurements to average after a change before deciding again
+    static const unsigned int SETTLE_SAMPLES = 8;
+    // how far below the target the time has to be before the scale goes up
+    static constexpr float HEADROOM = 0.85f;
+
+    float targetMilliseconds;
+    // scales as whole numbers of SCALE_STEP, so float rounding never passes for a change
+    int minStep;
+    int maxStep;
+    int step;
+    float averageMilliseconds = 0.0f;
+    unsigned int samples = 0;
+    unsigned int queries[QUERY_COUNT];
+    int querySteps[QUERY_COUNT] = {};   // the scale each query's frame was rendered at
+    bool pending[QUERY_COUNT] = {};
+    unsigned int next = 0;
+    bool timing = false;
+
+    // oldest first, stops at the first query that isn't done yet
+    void readResults()
+    {
+        for (unsigned int i = 0; i < QUERY_COUNT; i++)
+        {
+            unsigned int query = (next + i) % QUERY_COUNT;
+            if (!pending[query])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds);
+            pending[query] = false;
+            if (querySteps[query] == step)
+                addSample(nanoseconds / 1e6f);
+        }
+    }
+
+    void addSample(float milliseconds)
+    {
+        averageMilliseconds = samples == 0 ? milliseconds : averageMilliseconds * 0.8f + milliseconds * 0.2f;
+        if (++samples < SETTLE_SAMPLES)
+            return;
+
+        float desired = Scale() * std::sqrt(targetMilliseconds / std::max(averageMilliseconds, 0.01f));
+        int desiredStep = std::max(minStep, std::min(maxStep, toStep(desired)));
+        bool lower = desiredStep < step;
+        bool raise = desiredStep > step && averageMilliseconds < targetMilliseconds * HEADROOM;
+        if (lower || raise)
+        {
+            step = desiredStep;
+            samples = 0;
+        }
+    }
+
+    static int toStep(float scale)
+    {
+        return (int)std::round(scale / SCALE_STEP);
+    }
+};
+
+#endif
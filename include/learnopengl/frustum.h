@@ -0,0 +1,106 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// The six planes of a view frustum as (normal, distance) with normalized normals pointing inwards, so
+// dot(plane.xyz, p) + plane.w is the signed distance of p from the plane.
+// The tests run on all the planes at once with SSE: the planes are also kept transposed in two groups of four,
+// padded with two planes nothing is ever outside of.
+struct Frustum {
+    enum Plane { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+    glm::vec4 planes[PLANE_COUNT];
+    alignas(16) float planeX[8];
+    alignas(16) float planeY[8];
+    alignas(16) float planeZ[8];
+    alignas(16) float planeW[8];
+
+    // extracts the planes from a projection * view matrix (Gribb/Hartmann)
+    static Frustum FromMatrix(const glm::mat4 &m)
+    {
+        Frustum frustum;
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        frustum.planes[LEFT_PLANE] = row3 + row0;
+        frustum.planes[RIGHT_PLANE] = row3 - row0;
+        frustum.planes[BOTTOM_PLANE] = row3 + row1;
+        frustum.planes[TOP_PLANE] = row3 - row1;
+        frustum.planes[NEAR_PLANE] = row3 + row2;
+        frustum.planes[FAR_PLANE] = row3 - row2;
+        for (glm::vec4 &plane : frustum.planes)
+            plane = plane / glm::length(glm::vec3(plane));
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec4 plane = i < PLANE_COUNT ? frustum.planes[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1e30f);
+            frustum.planeX[i] = plane.x;
+            frustum.planeY[i] = plane.y;
+            frustum.planeZ[i] = plane.z;
+            frustum.planeW[i] = plane.w;
+        }
+        return frustum;
+    }
+
+    // false when the sphere is completely outside of one of the planes
+    bool IntersectsSphere(const glm::vec3 &center, float radius) const
+    {
+#ifdef FRUSTUM_SSE
+        __m128 x = _mm_set1_ps(center.x), y = _mm_set1_ps(center.y), z = _mm_set1_ps(center.z);
+        __m128 negativeRadius = _mm_set1_ps(-radius);
+        for (int i = 0; i < 8; i += 4)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(planeX + i), x),
+                                                    _mm_mul_ps(_mm_load_ps(planeY + i), y)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_load_ps(planeZ + i), z), _mm_load_ps(planeW + i)));
+            if (_mm_movemask_ps(_mm_cmplt_ps(distance, negativeRadius)))
+                return false;
+        }
+        return true;
+#else
+        for (const glm::vec4 &plane : planes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                return false;
+        return true;
+#endif
+    }
+
+    // false when the axis aligned box (center, half extents) is completely outside of one of the planes
+    bool IntersectsBox(const glm::vec3 &center, const glm::vec3 &extents) const
+    {
+#ifdef FRUSTUM_SSE
+        __m128 x = _mm_set1_ps(center.x), y = _mm_set1_ps(center.y), z = _mm_set1_ps(center.z);
+        __m128 ex = _mm_set1_ps(extents.x), ey = _mm_set1_ps(extents.y), ez = _mm_set1_ps(extents.z);
+        __m128 signBit = _mm_set1_ps(-0.0f);
+        for (int i = 0; i < 8; i += 4)
+        {
+            __m128 px = _mm_load_ps(planeX + i), py = _mm_load_ps(planeY + i), pz = _mm_load_ps(planeZ + i);
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, x), _mm_mul_ps(py, y)),
+                                         _mm_add_ps(_mm_mul_ps(pz, z), _mm_load_ps(planeW + i)));
+            // projected radius of the box onto the plane normal
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signBit, px), ex),
+                                                  _mm_mul_ps(_mm_andnot_ps(signBit, py), ey)),
+                                       _mm_mul_ps(_mm_andnot_ps(signBit, pz), ez));
+            if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps())))
+                return false;
+        }
+        return true;
+#else
+        for (const glm::vec4 &plane : planes)
+        {
+            glm::vec3 normal(plane);
+            if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extents) < 0.0f)
+                return false;
+        }
+        return true;
+#endif
+    }
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef GAUSSIAN_KERNEL_H
+#define GAUSSIAN_KERNEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// taps per side blur.fs has room for (its MAX_TAPS), the center one included
+const unsigned int GAUSSIAN_MAX_TAPS = 16;
+// the widest radius that fits in GAUSSIAN_MAX_TAPS linear taps
+const int GAUSSIAN_MAX_RADIUS = 2 * (GAUSSIAN_MAX_TAPS - 1);
+
+// One side of a separable gaussian blur for bilinear sampling: two neighbouring texels are read with a single
+// fetch between them, at the offset where the hardware's linear filter weights them like the kernel does
+// (Rákos, "Efficient Gaussian blur with linear sampling"). A radius r kernel takes 1 + ceil(r / 2) fetches per
+// side instead of 1 + r. offsets[0] is the center, the other taps are used at +offset and -offset.
+struct GaussianKernel {
+    std::vector<float> offsets;
+    std::vector<float> weights;
+
+    // radius in texels (at most GAUSSIAN_MAX_RADIUS), sigma is half of it
+    static GaussianKernel Linear(int radius)
+    {
+        radius = std::max(1, std::min(radius, GAUSSIAN_MAX_RADIUS));
+        float sigma = radius * 0.5f;
+
+        std::vector<float> discrete(radius + 1);
+        float sum = 0.0f;
+        for (int i = 0; i <= radius; i++)
+        {
+            discrete[i] = std::exp(-(float)(i * i) / (2.0f * sigma * sigma));
+            sum += i == 0 ? discrete[i] : 2.0f * discrete[i];
+        }
+        for (float &weight : discrete)
+            weight /= sum;
+
+        GaussianKernel kernel;
+        kernel.offsets.push_back(0.0f);
+        kernel.weights.push_back(discrete[0]);
+        for (int i = 1; i <= radius; i += 2)
+        {
+            float first = discrete[i];
+            float second = i + 1 <= radius ? discrete[i + 1] : 0.0f;
+            float weight = first + second;
+            kernel.offsets.push_back((i * first + (i + 1) * second) / weight);
+            kernel.weights.push_back(weight);
+        }
+        return kernel;
+    }
+
+    unsigned int TapCount() const { return weights.size(); }
+};
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/vertex.h>
+
+#include <cstddef>
+
+enum VertexFormat {
+    VERTEX_FORMAT_FLOAT,    // Vertex
+    VERTEX_FORMAT_PACKED,   // PackedVertex
+    VERTEX_FORMAT_COUNT
+};
+
+// where a mesh lives inside the arena, drawn with glDrawElementsBaseVertex
+struct GeometryRange {
+    int baseVertex;
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
+// Process wide storage for static geometry: every vertex format has one VBO, one IBO and one VAO, and meshes are
+// ranges inside them. Drawing any number of meshes of the same format needs a single VAO bind.
+// Allocation is a bump pointer, a format's buffers start over once all its ranges are freed. Growing keeps the
+// buffer names, so VAOs built on them (CreateVertexArray) stay valid.
+class GeometryArena
+{
+public:
+    static GeometryArena& Instance()
+    {
+        static GeometryArena arena;
+        return arena;
+    }
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    static size_t VertexSize(VertexFormat format)
+    {
+        return format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+
+    GeometryRange Allocate(VertexFormat format, const void *vertices, unsigned int vertexCount,
+                           const unsigned int *indices, unsigned int indexCount)
+    {
+        Pool &pool = pools[format];
+        if (!pool.VAO)
+            createPool(format, pool);
+
+        size_t vertexSize = VertexSize(format);
+        if (pool.vertexCount + vertexCount > pool.vertexCapacity)
+        {
+            size_t capacity = grownCapacity(pool.vertexCapacity, pool.vertexCount + vertexCount, INITIAL_VERTICES);
+            growBuffer(pool.VBO, pool.vertexCount * vertexSize, capacity * vertexSize);
+            pool.vertexCapacity = capacity;
+        }
+        if (pool.indexCount + indexCount > pool.indexCapacity)
+        {
+            size_t capacity = grownCapacity(pool.indexCapacity, pool.indexCount + indexCount, INITIAL_INDICES);
+            growBuffer(pool.IBO, pool.indexCount * sizeof(unsigned int), capacity * sizeof(unsigned int));
+            pool.indexCapacity = capacity;
+        }
+
+        // the copy targets leave the VAO's element buffer binding alone
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.VBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, pool.vertexCount * vertexSize, vertexCount * vertexSize, vertices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.IBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, pool.indexCount * sizeof(unsigned int),
+                        indexCount * sizeof(unsigned int), indices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        GeometryRange range = {(int)pool.vertexCount, (unsigned int)pool.indexCount, indexCount};
+        pool.vertexCount += vertexCount;
+        pool.indexCount += indexCount;
+        pool.liveRanges++;
+        return range;
+    }
+
+    // extra indices for vertices already in the arena (e.g. the levels of detail of a mesh), returns their first
+    // index. They're not a range of their own, they go away with the range they belong to.
+    unsigned int AllocateIndices(VertexFormat format, const unsigned int *indices, unsigned int indexCount)
+    {
+        Pool &pool = pools[format];
+        if (pool.indexCount + indexCount > pool.indexCapacity)
+        {
+            size_t capacity = grownCapacity(pool.indexCapacity, pool.indexCount + indexCount, INITIAL_INDICES);
+            growBuffer(pool.IBO, pool.indexCount * sizeof(unsigned int), capacity * sizeof(unsigned int));
+            pool.indexCapacity = capacity;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.IBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, pool.indexCount * sizeof(unsigned int),
+                        indexCount * sizeof(unsigned int), indices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        unsigned int firstIndex = pool.indexCount;
+        pool.indexCount += indexCount;
+        return firstIndex;
+    }
+
+    void Free(VertexFormat format)
+    {
+        Pool &pool = pools[format];
+        if (pool.liveRanges > 0 && --pool.liveRanges == 0)
+            pool.vertexCount = pool.indexCount = 0;
+    }
+
+    // the shared VAO of the format, 0 until something was allocated
+    unsigned int VertexArray(VertexFormat format) const { return pools[format].VAO; }
+
+    // a new VAO reading the format's buffers with the standard attribute layout, for drawing with extra
+    // attributes (e.g. per instance data). The caller owns it.
+    unsigned int CreateVertexArray(VertexFormat format)
+    {
+        Pool &pool = pools[format];
+        if (!pool.VAO)
+            createPool(format, pool);
+        unsigned int VAO;
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.IBO);
+        setupAttributes(format);
+        glBindVertexArray(0);
+        return VAO;
+    }
+
+    // deletes all the buffers, has to happen while the GL context is still alive and after every mesh is gone.
+    void Clear()
+    {
+        for (Pool &pool : pools)
+        {
+            if (pool.VAO)
+            {
+                glDeleteVertexArrays(1, &pool.VAO);
+                glDeleteBuffers(1, &pool.VBO);
+                glDeleteBuffers(1, &pool.IBO);
+            }
+            pool = Pool();
+        }
+    }
+
+private:
+    static const size_t INITIAL_VERTICES = 256 * 1024;
+    static const size_t INITIAL_INDICES = 1024 * 1024;
+
+    struct Pool {
+        unsigned int VAO = 0;
+        unsigned int VBO = 0;
+        unsigned int IBO = 0;
+        size_t vertexCount = 0;
+        size_t vertexCapacity = 0;
+        size_t indexCount = 0;
+        size_t indexCapacity = 0;
+        unsigned int liveRanges = 0;
+    };
+
+    Pool pools[VERTEX_FORMAT_COUNT];
+
+    GeometryArena() = default;
+
+    void createPool(VertexFormat format, Pool &pool)
+    {
+        glGenVertexArrays(1, &pool.VAO);
+        glGenBuffers(1, &pool.VBO);
+        glGenBuffers(1, &pool.IBO);
+        glBindVertexArray(pool.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.IBO);
+        setupAttributes(format);
+        glBindVertexArray(0);
+    }
+
+    static size_t grownCapacity(size_t capacity, size_t needed, size_t initial)
+    {
+        capacity = capacity ? capacity : initial;
+        while (capacity < needed)
+            capacity *= 2;
+        return capacity;
+    }
+
+    // reallocates the buffer's storage under the same name, keeping its first usedBytes
+    static void growBuffer(unsigned int buffer, size_t usedBytes, size_t newSize)
+    {
+        unsigned int temp = 0;
+        if (usedBytes)
+        {
+            glGenBuffers(1, &temp);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+            glBufferData(GL_COPY_WRITE_BUFFER, usedBytes, NULL, GL_STREAM_COPY);
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, newSize, NULL, GL_STATIC_DRAW);
+        if (usedBytes)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, temp);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+            glDeleteBuffers(1, &temp);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // attribute layout of the format for the VAO and GL_ARRAY_BUFFER currently bound
+    static void setupAttributes(VertexFormat format)
+    {
+        if (format == VERTEX_FORMAT_PACKED)
+        {
+            // normalized integer attributes, the shader sees them in [-1, 1] / [0, 1]
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+            return;
+        }
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    }
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/cloud_field.h>
+#include <learnopengl/instance_culler.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/uniform_buffer.h>
+
+#include <cstddef>
+#include <iostream>
+
+// A picture of a model drawn on camera facing quads instead of the model, for instances so far away that their
+// shape doesn't matter anymore. Bake() renders the model once, from the front and with an orthographic camera
+// fitting its bounding sphere, into an RGBA texture with mipmaps; the transparent background is discarded when
+// the billboards are drawn. Billboards are placed and sized from CloudInstances, the instance's rotation is lost.
+class Impostor
+{
+public:
+    explicit Impostor(unsigned int resolution = 128)
+        : bakeShader("resources/shaders/impostorBake.vs", "resources/shaders/instanceShader.fs"),
+          drawShader("resources/shaders/impostor.vs", "resources/shaders/impostor.fs"),
+          resolution(resolution)
+    {
+        drawShader.BindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, resolution, resolution, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    Impostor(const Impostor&) = delete;
+    Impostor& operator=(const Impostor&) = delete;
+
+    // renders the model (float vertices, diffuseTexture on all of its meshes) into the impostor texture. Keeps the
+    // bound framebuffer, viewport and blending as they were.
+    void Bake(const Model &model, unsigned int diffuseTexture)
+    {
+        sphere = InstanceCuller::BoundingSphere(model);
+        float radius = sphere.w;
+        glm::vec3 center(sphere);
+        glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+        glm::mat4 view = glm::lookAt(center + glm::vec3(0.0f, 0.0f, radius), center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+        GLint previousFramebuffer, viewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+
+        unsigned int framebuffer, depth;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, resolution, resolution);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::IMPOSTOR::Framebuffer is not complete!" << std::endl;
+
+        glViewport(0, 0, resolution, resolution);
+        glDisable(GL_BLEND);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        bakeShader.use();
+        bakeShader.setMat4("viewProjection", projection * view);
+        bakeShader.setInt("texture_diffuse", 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+        for (const Mesh &mesh : model.meshes)
+        {
+            glBindVertexArray(mesh.VAO);
+            glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, mesh.IndexOffset(), mesh.baseVertex);
+        }
+        glBindVertexArray(0);
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &depth);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        if (blend)
+            glEnable(GL_BLEND);
+        baked = true;
+    }
+
+    bool Baked() const { return baked; }
+    unsigned int Texture() const { return texture; }
+
+    // a VAO drawing one billboard per CloudInstance of the buffer, the quad's corners come from gl_VertexID
+    static unsigned int CreateVertexArray(unsigned int instanceBuffer)
+    {
+        unsigned int VAO;
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(CloudInstance), (void*)offsetof(CloudInstance, positionScale));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(CloudInstance), (void*)offsetof(CloudInstance, rotation));
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribDivisor(4, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return VAO;
+    }
+
+    // draws count billboards from a VAO made by CreateVertexArray, placed with the Camera uniform block
+    void Draw(unsigned int VAO, unsigned int count)
+    {
+        if (!baked || count == 0)
+            return;
+        drawShader.use();
+        drawShader.setVec4("boundingSphere", sphere);
+        drawShader.setInt("impostor", 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glBindVertexArray(VAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        glBindVertexArray(0);
+    }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        glDeleteTextures(1, &texture);
+        glDeleteProgram(bakeShader.ID);
+        glDeleteProgram(drawShader.ID);
+        texture = 0;
+    }
+
+private:
+    Shader bakeShader;
+    Shader drawShader;
+    unsigned int resolution;
+    unsigned int texture = 0;
+    glm::vec4 sphere = glm::vec4(0.0f);
+    bool baked = false;
+};
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef INSTANCE_CULLER_H
+#define INSTANCE_CULLER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/cloud_field.h>
+#include <learnopengl/depth_pyramid.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Frustum culls the instances of an instanced draw on the GPU. Instances are CloudInstances (position, scale and
+// rotation). Cull() runs one point per instance of the given ranges through transform feedback with the rasterizer
+// off; the geometry shader only emits the instances whose bounding sphere touches the frustum, so they come out
+// packed at the start of an output buffer and a GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN query counts them.
+// GL 3.3 can't source a draw's instance count from the GPU, the count has to be read back. To never wait for it,
+// the outputs are double buffered: the draw uses the buffer culled in the previous frame (ReadBuffer(),
+// VisibleCount()) while the current frame's pass runs, so culling lags a frame. Cull with a slightly wider frustum
+// than the one you draw with to hide that.
+// The visible instances are also sorted into buckets by their distance to the viewer, one for every level of detail
+// they're drawn at, each with its own outputs and query. GL 3.3 only has a single transform feedback stream, so
+// that's one pass over the instances per bucket, each keeping the instances within its distance band.
+// With a depth pyramid the instances are also tested for occlusion, the ones completely behind the depth it was
+// built from are dropped as well. That result lags a frame too, so the screen rectangle tested grows by a margin
+// covering how far the view may turn in between.
+class InstanceCuller
+{
+public:
+    // instanceBuffer has room for count CloudInstances. lodDistances are the distances where the buckets change,
+    // ascending, so there's one bucket more than distances (everything in a single bucket without any).
+    InstanceCuller(unsigned int instanceBuffer, unsigned int count, const std::vector<float> &lodDistances = {})
+        : shader("resources/shaders/instanceCull.vs", "resources/shaders/instanceCull.gs",
+                 {"culledPositionScale", "culledRotation"}),
+          count(count), buckets(lodDistances.size() + 1)
+    {
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(CloudInstance), (void*)offsetof(CloudInstance, positionScale));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CloudInstance), (void*)offsetof(CloudInstance, rotation));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        for (unsigned int bucket = 0; bucket < buckets.size(); bucket++)
+        {
+            Bucket &b = buckets[bucket];
+            b.minDistance = bucket == 0 ? 0.0f : lodDistances[bucket - 1];
+            b.maxDistance = bucket < lodDistances.size() ? lodDistances[bucket] : 1e30f;
+            glGenBuffers(2, b.outputs);
+            glGenQueries(2, b.queries);
+            // every bucket can end up with all the instances
+            for (unsigned int i = 0; i < 2; i++)
+            {
+                glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, b.outputs[i]);
+                glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, count * sizeof(CloudInstance), NULL, GL_STREAM_COPY);
+            }
+        }
+        glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+        frustumPlanes = shader.Location("frustumPlanes");
+        boundingSphere = shader.Location("boundingSphere");
+        viewPosition = shader.Location("viewPosition");
+        distanceRange = shader.Location("distanceRange");
+        occlusionCulling = shader.Location("occlusionCulling");
+        pyramidLevels = shader.Location("pyramidLevels");
+        occlusionViewProjection = shader.Location("occlusionViewProjection");
+        occlusionMargin = shader.Location("occlusionMargin");
+        shader.use();
+        shader.setInt("depthPyramid", DEPTH_PYRAMID_TEXTURE_UNIT);
+        glUseProgram(0);
+    }
+
+    InstanceCuller(const InstanceCuller&) = delete;
+    InstanceCuller& operator=(const InstanceCuller&) = delete;
+
+    // culls the instances of the ranges against the frustum (and the occluders in the pyramid, when there is one)
+    // and buckets them by their distance to viewPos, sphere is the object space bounding sphere (center, radius) of
+    // the instanced model. margin (in NDC units) is added to every side of an instance's screen rectangle
+    // before it's tested against the pyramid. Leaves the program unbound.
+    void Cull(const Frustum &frustum, const glm::vec3 &viewPos, const glm::vec4 &sphere,
+              const std::vector<InstanceRange> &ranges, const DepthPyramid *pyramid = nullptr,
+              float margin = 0.0f)
+    {
+        // what the previous pass wrote becomes the draw buffer, grab its count before its query is reused
+        write = 1 - write;
+        for (Bucket &bucket : buckets)
+            bucket.visible = culled[1 - write] ? readCount(bucket, 1 - write) : 0;
+
+        shader.use();
+        glUniform4fv(frustumPlanes, Frustum::PLANE_COUNT, &frustum.planes[0][0]);
+        shader.setVec4(boundingSphere, sphere);
+        shader.setVec3(viewPosition, viewPos);
+        shader.setBool(occlusionCulling, pyramid != nullptr);
+        if (pyramid)
+        {
+            shader.setInt(pyramidLevels, pyramid->Levels());
+            shader.setMat4(occlusionViewProjection, pyramid->ViewProjection());
+            shader.setFloat(occlusionMargin, margin);
+            glActiveTexture(GL_TEXTURE0 + DEPTH_PYRAMID_TEXTURE_UNIT);
+            glBindTexture(GL_TEXTURE_2D, pyramid->Texture());
+            glActiveTexture(GL_TEXTURE0);
+        }
+
+        // a single primitive query and output stream per bucket for all the ranges
+        firsts.clear();
+        counts.clear();
+        for (const InstanceRange &range : ranges)
+        {
+            firsts.push_back(range.first);
+            counts.push_back(range.count);
+        }
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(VAO);
+        for (Bucket &bucket : buckets)
+        {
+            shader.setVec2(distanceRange, glm::vec2(bucket.minDistance, bucket.maxDistance));
+            glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, bucket.outputs[write]);
+            glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, bucket.queries[write]);
+            glBeginTransformFeedback(GL_POINTS);
+            if (!ranges.empty())
+                glMultiDrawArrays(GL_POINTS, firsts.data(), counts.data(), ranges.size());
+            glEndTransformFeedback();
+            glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        }
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        glUseProgram(0);
+        culled[write] = true;
+    }
+
+    // the output buffers of a bucket, build a VAO for each of them to draw the culled instances
+    unsigned int OutputBuffer(unsigned int bucket, unsigned int i) const { return buckets[bucket].outputs[i]; }
+    // index of the outputs to draw from this frame and how many instances they hold
+    unsigned int ReadBuffer() const { return 1 - write; }
+    unsigned int VisibleCount(unsigned int bucket) const { return buckets[bucket].visible; }
+    unsigned int VisibleCount() const
+    {
+        unsigned int visible = 0;
+        for (const Bucket &bucket : buckets)
+            visible += bucket.visible;
+        return visible;
+    }
+    unsigned int BucketCount() const { return buckets.size(); }
+    unsigned int InstanceCount() const { return count; }
+
+    // object space bounding sphere of a model's meshes
+    static glm::vec4 BoundingSphere(const Model &model)
+    {
+        if (model.meshes.empty())
+            return glm::vec4(0.0f);
+        glm::vec3 boundsMin = model.meshes[0].boundsMin, boundsMax = model.meshes[0].boundsMax;
+        for (const Mesh &mesh : model.meshes)
+        {
+            boundsMin = glm::min(boundsMin, mesh.boundsMin);
+            boundsMax = glm::max(boundsMax, mesh.boundsMax);
+        }
+        return glm::vec4((boundsMin + boundsMax) * 0.5f, glm::length(boundsMax - boundsMin) * 0.5f);
+    }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        for (Bucket &bucket : buckets)
+        {
+            glDeleteBuffers(2, bucket.outputs);
+            glDeleteQueries(2, bucket.queries);
+        }
+        glDeleteProgram(shader.ID);
+        VAO = 0;
+    }
+
+private:
+    // instances from minDistance (inclusive) to maxDistance
+    struct Bucket {
+        float minDistance;
+        float maxDistance;
+        unsigned int outputs[2];
+        unsigned int queries[2];
+        unsigned int visible = 0;
+    };
+
+    Shader shader;
+    unsigned int count;
+    std::vector<Bucket> buckets;
+    unsigned int VAO = 0;
+    bool culled[2] = {false, false};
+    unsigned int write = 1;
+    GLint frustumPlanes;
+    GLint boundingSphere;
+    GLint viewPosition;
+    GLint distanceRange;
+    GLint occlusionCulling;
+    GLint pyramidLevels;
+    GLint occlusionViewProjection;
+    GLint occlusionMargin;
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts;
+
+    // a frame old by now, so the result is normally there already and this doesn't stall
+    unsigned int readCount(const Bucket &bucket, unsigned int i) const
+    {
+        GLuint written = 0;
+        glGetQueryObjectuiv(bucket.queries[i], GL_QUERY_RESULT, &written);
+        return std::min(written, count);
+    }
+};
+
+#endif
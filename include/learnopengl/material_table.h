@@ -0,0 +1,358 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/uniform_buffer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process wide table of the materials of the lit models (MESH_MATERIAL_TABLE). A material is resolved once, at
+// load time: its textures are copied into layers of GL_TEXTURE_2D_ARRAYs, one array per size and format, and its
+// entry in the Materials uniform block says which layers to sample. A draw then only needs its material ID, the
+// arrays stay bound as long as consecutive materials use the same ones (see BatchRenderer).
+// The images still arrive through the TextureRegistry. Once one is uploaded Update() copies it into its layer on
+// the GPU and drops the 2D texture, so a texture doesn't take its memory twice.
+// Material 0 is the default material without textures, it's also what Acquire returns once the table is full.
+class MaterialTable
+{
+public:
+    static MaterialTable& Instance()
+    {
+        static MaterialTable table;
+        return table;
+    }
+
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    // returns the material sampling the two files (either may be empty), queuing their loads if needed. Every
+    // Acquire has to be matched by a Release.
+    int Acquire(const std::string &diffuse, const std::string &specular, bool gamma = false)
+    {
+        std::string diffuseKey = acquireLayer(diffuse, gamma);
+        std::string specularKey = acquireLayer(specular, gamma);
+        std::string key = diffuseKey + '\n' + specularKey;
+        auto found = ids.find(key);
+        if (found != ids.end())
+        {
+            releaseLayer(diffuseKey);
+            releaseLayer(specularKey);
+            materials[found->second].references++;
+            return found->second;
+        }
+
+        int id = -1;
+        for (unsigned int i = 1; i < materials.size() && id < 0; i++)
+            if (materials[i].references == 0)
+                id = i;
+        if (id < 0 && materials.size() < MAX_MATERIALS)
+        {
+            id = materials.size();
+            materials.push_back(Material());
+        }
+        if (id < 0)
+        {
+            std::cout << "ERROR::MATERIAL_TABLE::FULL: more than " << MAX_MATERIALS << " materials" << std::endl;
+            releaseLayer(diffuseKey);
+            releaseLayer(specularKey);
+            return 0;
+        }
+        materials[id] = {diffuseKey, specularKey, key, 1};
+        ids[key] = id;
+        dirty = true;
+        return id;
+    }
+
+    void Release(int id)
+    {
+        if (id <= 0 || id >= (int)materials.size() || materials[id].references == 0)
+            return;
+        Material &material = materials[id];
+        if (--material.references > 0)
+            return;
+        releaseLayer(material.diffuse);
+        releaseLayer(material.specular);
+        ids.erase(material.key);
+        material = Material();
+        dirty = true;
+    }
+
+    // copies the textures that finished loading into their array layers and uploads the changed materials.
+    // Call it after the TextureRegistry loader's Update/Finish.
+    void Update()
+    {
+        if (!block)
+        {
+            glGenBuffers(1, &block);
+            glBindBuffer(GL_UNIFORM_BUFFER, block);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialsBlock), NULL, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, MATERIALS_BLOCK_BINDING, block);
+            dirty = true;
+        }
+
+        TextureLoader &loader = TextureRegistry::Instance().Loader();
+        std::vector<Layer*> ready;
+        for (auto &entry : layers)
+            if (entry.second.texture && !loader.IsPending(entry.second.texture))
+                ready.push_back(&entry.second);
+        if (!ready.empty())
+            resolve(ready);
+
+        if (dirty)
+            uploadBlock();
+    }
+
+    // the arrays the material's diffuse and specular layers live in, 0 while they aren't resolved yet
+    unsigned int DiffuseArray(int id) const { return arrayOf(materials[id].diffuse); }
+    unsigned int SpecularArray(int id) const { return arrayOf(materials[id].specular); }
+
+    unsigned int Size() const { return ids.size(); }
+
+    // deletes the arrays and the uniform buffer, has to happen while the GL context is still alive and after
+    // every model is gone.
+    void Clear()
+    {
+        for (Bucket &bucket : buckets)
+            glDeleteTextures(1, &bucket.texture);
+        if (block)
+            glDeleteBuffers(1, &block);
+        if (pbo)
+            glDeleteBuffers(1, &pbo);
+        buckets.clear();
+        layers.clear();
+        ids.clear();
+        materials.assign(1, Material());
+        block = pbo = 0;
+    }
+
+private:
+    // one texture in an array layer, shared by every material using the file
+    struct Layer {
+        unsigned int texture = 0;   // registry texture until it's copied into the array
+        int bucket = -1;
+        int layer = -1;
+        unsigned int references = 0;
+    };
+    // an array of same sized, same format layers
+    struct Bucket {
+        GLint width, height, levels;
+        GLenum internalFormat;
+        bool compressed;
+        unsigned int texture = 0;
+        int capacity = 0;
+        std::vector<int> freeLayers;
+    };
+    struct Material {
+        std::string diffuse, specular;  // layer keys, empty for none
+        std::string key;
+        unsigned int references = 0;
+    };
+
+    std::unordered_map<std::string, Layer> layers;
+    std::unordered_map<std::string, int> ids;
+    std::vector<Material> materials;
+    std::vector<Bucket> buckets;
+    unsigned int block = 0;
+    unsigned int pbo = 0;
+    bool dirty = true;
+
+    MaterialTable() : materials(1) {}
+
+    std::string acquireLayer(const std::string &filename, bool gamma)
+    {
+        if (filename.empty())
+            return std::string();
+        std::string key = TextureRegistry::CanonicalPath(filename) + (gamma ? "|srgb" : "");
+        Layer &layer = layers[key];
+        if (layer.references++ == 0)
+            layer.texture = TextureRegistry::Instance().Acquire(filename, gamma);
+        return key;
+    }
+
+    void releaseLayer(const std::string &key)
+    {
+        auto found = layers.find(key);
+        if (found == layers.end() || --found->second.references > 0)
+            return;
+        Layer &layer = found->second;
+        if (layer.texture)
+            TextureRegistry::Instance().Release(layer.texture);
+        if (layer.bucket >= 0)
+            buckets[layer.bucket].freeLayers.push_back(layer.layer);
+        layers.erase(found);
+    }
+
+    unsigned int arrayOf(const std::string &key) const
+    {
+        if (key.empty())
+            return 0;
+        const Layer &layer = layers.at(key);
+        return layer.bucket >= 0 ? buckets[layer.bucket].texture : 0;
+    }
+
+    int layerOf(const std::string &key) const
+    {
+        return key.empty() ? -1 : layers.at(key).layer;
+    }
+
+    // finds the bucket of every ready texture, grows the buckets once for all of them and copies them in
+    void resolve(const std::vector<Layer*> &ready)
+    {
+        for (Layer *layer : ready)
+            layer->bucket = findBucket(layer->texture);
+
+        std::vector<int> needed(buckets.size(), 0);
+        for (Layer *layer : ready)
+            needed[layer->bucket]++;
+        for (unsigned int i = 0; i < buckets.size(); i++)
+            if (needed[i] > (int)buckets[i].freeLayers.size())
+                growBucket(buckets[i], needed[i] - buckets[i].freeLayers.size());
+
+        for (Layer *layer : ready)
+        {
+            Bucket &bucket = buckets[layer->bucket];
+            layer->layer = bucket.freeLayers.back();
+            bucket.freeLayers.pop_back();
+            copyLayers(GL_TEXTURE_2D, layer->texture, bucket, layer->layer, 1);
+            TextureRegistry::Instance().Release(layer->texture);
+            layer->texture = 0;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        dirty = true;
+    }
+
+    int findBucket(unsigned int texture)
+    {
+        Bucket format;
+        GLint compressed, maxLevel;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &format.width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &format.height);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, (GLint*)&format.internalFormat);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+        format.compressed = compressed != 0;
+        // uncompressed images have a generated full chain, DDS files say how many levels they have
+        GLint fullChain = (GLint)std::floor(std::log2((float)std::max(format.width, format.height))) + 1;
+        format.levels = std::min(fullChain, maxLevel + 1);
+
+        for (unsigned int i = 0; i < buckets.size(); i++)
+        {
+            const Bucket &bucket = buckets[i];
+            if (bucket.width == format.width && bucket.height == format.height && bucket.levels == format.levels &&
+                bucket.internalFormat == format.internalFormat)
+                return i;
+        }
+        buckets.push_back(format);
+        return buckets.size() - 1;
+    }
+
+    // reallocates the array with room for count more layers, keeping the layers it already has. It grows by
+    // exactly what's needed since a single layer of the big textures takes over 100MB.
+    void growBucket(Bucket &bucket, int count)
+    {
+        unsigned int old = bucket.texture;
+        int capacity = bucket.capacity + count;
+        glGenTextures(1, &bucket.texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, bucket.texture);
+        for (GLint level = 0; level < bucket.levels; level++)
+        {
+            GLsizei w = std::max(1, bucket.width >> level), h = std::max(1, bucket.height >> level);
+            if (bucket.compressed)
+            {
+                GLsizei size = ((w + 3) / 4) * ((h + 3) / 4) * compressedBlockSize(bucket.internalFormat);
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, bucket.internalFormat, w, h, capacity, 0,
+                                       size * capacity, NULL);
+            }
+            else
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level, bucket.internalFormat, w, h, capacity, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, NULL);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, bucket.levels - 1);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        if (old)
+        {
+            copyLayers(GL_TEXTURE_2D_ARRAY, old, bucket, 0, bucket.capacity);
+            glDeleteTextures(1, &old);
+        }
+        for (int layer = capacity - 1; layer >= bucket.capacity; layer--)
+            bucket.freeLayers.push_back(layer);
+        bucket.capacity = capacity;
+    }
+
+    // copies every level of source (a 2D texture, or the first count layers of an array) into the bucket's
+    // layers starting at firstLayer. The pixels go through a pixel buffer and never leave the GPU.
+    void copyLayers(GLenum sourceTarget, unsigned int source, const Bucket &bucket, int firstLayer, int count)
+    {
+        if (!pbo)
+            glGenBuffers(1, &pbo);
+        for (GLint level = 0; level < bucket.levels; level++)
+        {
+            GLsizei w = std::max(1, bucket.width >> level), h = std::max(1, bucket.height >> level);
+            glBindTexture(sourceTarget, source);
+            GLint size = w * h * 4 * count;
+            if (bucket.compressed)
+                glGetTexLevelParameteriv(sourceTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_COPY);
+            if (bucket.compressed)
+                glGetCompressedTexImage(sourceTarget, level, 0);
+            else
+                glGetTexImage(sourceTarget, level, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, bucket.texture);
+            if (bucket.compressed)
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, firstLayer, w, h, count,
+                                          bucket.internalFormat, size, 0);
+            else
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, firstLayer, w, h, count, GL_RGBA,
+                                GL_UNSIGNED_BYTE, 0);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    }
+
+    static GLsizei compressedBlockSize(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                return 8;
+            default:
+                return 16;
+        }
+    }
+
+    void uploadBlock()
+    {
+        MaterialsBlock data;
+        for (unsigned int i = 0; i < MAX_MATERIALS; i++)
+            data.materials[i] = glm::ivec4(-1);
+        for (unsigned int i = 0; i < materials.size(); i++)
+            if (materials[i].references > 0)
+                data.materials[i] = glm::ivec4(layerOf(materials[i].diffuse), layerOf(materials[i].specular), 0, 0);
+        glBindBuffer(GL_UNIFORM_BUFFER, block);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MaterialsBlock), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        dirty = false;
+    }
+};
+
+#endif
@@ -6,26 +6,34 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/geometry_arena.h>
+#include <learnopengl/material_table.h>
+#include <learnopengl/mesh_simplifier.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/vertex.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <vector>
 using namespace std;
 
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-};
+// Mesh construction flags
+const unsigned int MESH_KEEP_CPU_DATA = 1 << 0;    // keep vertices and indices in RAM after upload (picking, physics...)
+const unsigned int MESH_PACKED_VERTICES = 1 << 1;  // upload PackedVertex instead of Vertex, needs a shader that decodes it
+const unsigned int MESH_MATERIAL_TABLE = 1 << 2;   // textures go through the MaterialTable, needs a shader sampling the arrays
+const unsigned int MESH_GENERATE_LODS = 1 << 3;    // build simplified index buffers to draw the mesh with at a distance
 
+// levels of detail a mesh can have and the fraction of the full index count each of them aims for
+const unsigned int MESH_MAX_LODS = 3;
+const float MESH_LOD_RATIOS[MESH_MAX_LODS] = {1.0f, 0.25f, 0.0625f};
 
+// one level of detail, an index range drawn with the mesh's baseVertex
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
 
 struct Texture {
     unsigned int id;
@@ -33,40 +41,226 @@ struct Texture {
     string path;
 };
 
+// texture reference of an imported mesh, path is relative to the model directory
+struct MeshTextureRef {
+    string type;
+    string path;
+};
+
+// CPU side result of importing a mesh, it doesn't own any OpenGL objects yet
+struct MeshData {
+    vector<Vertex>         vertices;
+    vector<unsigned int>   indices;
+    vector<MeshTextureRef> textures;
+};
+
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data, vertices and indices are only kept on the CPU when asked for (MESH_KEEP_CPU_DATA), otherwise
+    // they're released once they're uploaded and the mesh is drawn from indexCount alone.
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
-    vector<Texture>      textures;
+    vector<Texture>      textures;     // bound one by one, empty for MaterialTable meshes
+    int materialID = -1;               // MaterialTable entry, owned by the model, -1 when the mesh uses textures
+
+    // draw range in the GeometryArena buffers of the mesh's vertex format
+    int baseVertex = 0;
+    unsigned int firstIndex = 0;
+    unsigned int indexCount = 0;
+    // levels of detail, lods[0] is the full range above, the coarser ones only exist with MESH_GENERATE_LODS
+    vector<MeshLod> lods;
+    // object space axis aligned bounding box and bounding sphere, for culling
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 sphereCenter;
+    float sphereRadius = 0.0f;
+    // vertex layout in the VBO and how to turn packed positions and UVs back into object space/texture space
+    bool packedVertices = false;
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec2 uvOffset = glm::vec2(0.0f);
+    glm::vec2 uvScale = glm::vec2(1.0f);
 
-    unsigned int VAO;
-    std::string glslIdentifierPrefix;
+    unsigned int VAO;   // shared by every mesh of the same vertex format, owned by the GeometryArena
+    std::string glslIdentifierPrefix;   // change it with SetTextureNamePrefix
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, unsigned int flags = 0)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        indexCount = this->indices.size();
+        packedVertices = (flags & MESH_PACKED_VERTICES) != 0;
+        computeBounds();
+        updateSamplerNames();
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
+        // now that we have all the required data, copy it into the geometry arena.
         setupMesh();
+        if (flags & MESH_GENERATE_LODS)
+            generateLods();
+
+        // the GPU has its own copy now
+        if (!(flags & MESH_KEEP_CPU_DATA))
+        {
+            vector<Vertex>().swap(this->vertices);
+            vector<unsigned int>().swap(this->indices);
+        }
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    bool HasCpuData() const { return !vertices.empty(); }
+
+    // a mesh owns its range of the arena, so it can be moved around but never copied
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh &&other) noexcept
+        : vertices(std::move(other.vertices)), indices(std::move(other.indices)), textures(std::move(other.textures)),
+          materialID(other.materialID), baseVertex(other.baseVertex), firstIndex(other.firstIndex), indexCount(other.indexCount),
+          lods(std::move(other.lods)),
+          boundsMin(other.boundsMin), boundsMax(other.boundsMax), sphereCenter(other.sphereCenter),
+          sphereRadius(other.sphereRadius), packedVertices(other.packedVertices),
+          positionOffset(other.positionOffset), positionScale(other.positionScale), uvOffset(other.uvOffset),
+          uvScale(other.uvScale), VAO(other.VAO), glslIdentifierPrefix(std::move(other.glslIdentifierPrefix)),
+          samplerNames(std::move(other.samplerNames)), bindings(std::move(other.bindings))
+    {
+        other.VAO = 0;
+    }
+
+    Mesh& operator=(Mesh &&other) noexcept
+    {
+        if (this != &other)
+        {
+            freeGeometry();
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            textures = std::move(other.textures);
+            materialID = other.materialID;
+            glslIdentifierPrefix = std::move(other.glslIdentifierPrefix);
+            samplerNames = std::move(other.samplerNames);
+            bindings = std::move(other.bindings);
+            baseVertex = other.baseVertex;
+            firstIndex = other.firstIndex;
+            indexCount = other.indexCount;
+            lods = std::move(other.lods);
+            boundsMin = other.boundsMin;
+            boundsMax = other.boundsMax;
+            sphereCenter = other.sphereCenter;
+            sphereRadius = other.sphereRadius;
+            packedVertices = other.packedVertices;
+            positionOffset = other.positionOffset;
+            positionScale = other.positionScale;
+            uvOffset = other.uvOffset;
+            uvScale = other.uvScale;
+            VAO = other.VAO;
+            other.VAO = 0;
+        }
+        return *this;
+    }
+
+    ~Mesh()
+    {
+        freeGeometry();
+    }
+
+    // sampler uniform names become prefix + type + N, e.g. "material.texture_diffuse1"
+    void SetTextureNamePrefix(const std::string &prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        updateSamplerNames();
+    }
+
+    VertexFormat Format() const { return packedVertices ? VERTEX_FORMAT_PACKED : VERTEX_FORMAT_FLOAT; }
+
+    // render the mesh, bindVertexArray can be false when the caller already bound VAO (see Model::Draw)
+    void Draw(Shader &shader, bool bindVertexArray = true)
+    {
+        BindTextures(shader);
+        SetVertexDecode(shader);
+
+        // draw mesh
+        if (bindVertexArray)
+            glBindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, IndexOffset(), baseVertex);
+        if (bindVertexArray)
+            glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // binds the textures to units 0..n and points the shader's samplers at them. MaterialTable meshes bind the
+    // arrays holding their layers to units 0 and 1 ("diffuseLayers", "specularLayers") and set "materialID".
+    void BindTextures(Shader &shader) const
+    {
+        const ShaderBindings &locations = bindingsFor(shader);
+        if (materialID >= 0)
+        {
+            const MaterialTable &table = MaterialTable::Instance();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, table.DiffuseArray(materialID));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, table.SpecularArray(materialID));
+            shader.setInt(locations.materialID, materialID);
+            return;
+        }
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.setInt(locations.samplers[i], i);
+            // and finally bind the texture
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+    }
+
+    // vertex decode, identity for float vertices
+    void SetVertexDecode(Shader &shader) const
+    {
+        const ShaderBindings &locations = bindingsFor(shader);
+        shader.setBool(locations.packedVertices, packedVertices);
+        shader.setVec3(locations.positionOffset, positionOffset);
+        shader.setVec3(locations.positionScale, positionScale);
+        shader.setVec2(locations.uvOffset, uvOffset);
+        shader.setVec2(locations.uvScale, uvScale);
+    }
+
+    // firstIndex as the byte offset the glDrawElements* calls expect
+    void* IndexOffset() const { return (void*)(firstIndex * sizeof(unsigned int)); }
+
+    // a level of detail, levels past the coarsest one the mesh has give the coarsest one
+    const MeshLod& Lod(unsigned int level) const { return lods[std::min<size_t>(level, lods.size() - 1)]; }
+    unsigned int LodCount() const { return lods.size(); }
+    static void* IndexOffset(const MeshLod &lod) { return (void*)(lod.firstIndex * sizeof(unsigned int)); }
+
+private:
+    // uniform locations of the mesh in one shader it was drawn with, so drawing doesn't build any strings
+    struct ShaderBindings {
+        unsigned int program = 0;
+        vector<GLint> samplers;     // per texture
+        GLint materialID = -1;
+        GLint packedVertices = -1;
+        GLint positionOffset = -1;
+        GLint positionScale = -1;
+        GLint uvOffset = -1;
+        GLint uvScale = -1;
+    };
+
+    vector<string> samplerNames;    // per texture, see SetTextureNamePrefix
+    // per shader the mesh was drawn with, a mesh only ever sees a handful (depth pre-pass, lighting...)
+    mutable vector<ShaderBindings> bindings;
+
+    // retrieve the sampler name of every texture (the N in diffuse_textureN)
+    void updateSamplerNames()
     {
-        // bind appropriate textures
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        samplerNames.clear();
+        for(const Texture &texture : textures)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
             string number;
-            string name = textures[i].type;
+            const string &name = texture.type;
             if(name == "texture_diffuse")
                 number = std::to_string(diffuseNr++);
             else if(name == "texture_specular")
@@ -75,65 +269,164 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerNames.push_back(glslIdentifierPrefix + name + number);
         }
+        bindings.clear();
+    }
 
+    // looks the locations up only the first time the mesh is drawn with a shader (or after it got a new prefix)
+    const ShaderBindings& bindingsFor(const Shader &shader) const
+    {
+        for (const ShaderBindings &cached : bindings)
+            if (cached.program == shader.ID)
+                return cached;
+        ShaderBindings added;
+        added.program = shader.ID;
+        for (const string &name : samplerNames)
+            added.samplers.push_back(shader.Location(name));
+        added.materialID = shader.Location("materialID");
+        added.packedVertices = shader.Location("packedVertices");
+        added.positionOffset = shader.Location("positionOffset");
+        added.positionScale = shader.Location("positionScale");
+        added.uvOffset = shader.Location("uvOffset");
+        added.uvScale = shader.Location("uvScale");
+        bindings.push_back(std::move(added));
+        return bindings.back();
+    }
 
+    void freeGeometry()
+    {
+        if (VAO)
+            GeometryArena::Instance().Free(Format());
+        VAO = 0;
+    }
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    void computeBounds()
+    {
+        boundsMin = boundsMax = vertices.empty() ? glm::vec3(0.0f) : vertices[0].Position;
+        for (const Vertex &vertex : vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+        // centered on the box, tighter than the box's own bounding sphere
+        sphereCenter = (boundsMin + boundsMax) * 0.5f;
+        float radiusSquared = 0.0f;
+        for (const Vertex &vertex : vertices)
+        {
+            glm::vec3 offset = vertex.Position - sphereCenter;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+        sphereRadius = std::sqrt(radiusSquared);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    static int16_t toSnorm16(float value)
+    {
+        value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+        return (int16_t)std::lround(value * 32767.0f);
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
+    static uint16_t toUnorm16(float value)
+    {
+        value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+        return (uint16_t)std::lround(value * 65535.0f);
+    }
+
+    // maps a unit vector onto the octahedron and unfolds it into [-1, 1]^2
+    static void octEncode(glm::vec3 n, int16_t out[2])
+    {
+        float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+        if (sum < 1e-20f)
+        {
+            out[0] = out[1] = 0;
+            return;
+        }
+        float x = n.x / sum, y = n.y / sum;
+        if (n.z < 0.0f)
+        {
+            float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = foldedX;
+            y = foldedY;
+        }
+        out[0] = toSnorm16(x);
+        out[1] = toSnorm16(y);
+    }
+
+    // quantizes the vertices, also sets up the decode ranges used by Draw
+    vector<PackedVertex> packVertices()
+    {
+        glm::vec3 halfExtent = (boundsMax - boundsMin) * 0.5f;
+        positionOffset = (boundsMin + boundsMax) * 0.5f;
+        positionScale = glm::max(halfExtent, glm::vec3(1e-6f));
+
+        glm::vec2 uvMin = vertices.empty() ? glm::vec2(0.0f) : vertices[0].TexCoords;
+        glm::vec2 uvMax = uvMin;
+        for (const Vertex &vertex : vertices)
+        {
+            uvMin = glm::min(uvMin, vertex.TexCoords);
+            uvMax = glm::max(uvMax, vertex.TexCoords);
+        }
+        uvOffset = uvMin;
+        uvScale = glm::max(uvMax - uvMin, glm::vec2(1e-6f));
+
+        vector<PackedVertex> packed(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const Vertex &vertex = vertices[i];
+            glm::vec3 position = (vertex.Position - positionOffset) / positionScale;
+            glm::vec2 uv = (vertex.TexCoords - uvOffset) / uvScale;
+            // the bitangent is cross(normal, tangent) up to its sign
+            glm::vec3 bitangent = glm::cross(vertex.Normal, vertex.Tangent);
+            float handedness = glm::dot(bitangent, vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
 
-    // initializes all the buffer objects/arrays
+            PackedVertex &out = packed[i];
+            out.Position[0] = toSnorm16(position.x);
+            out.Position[1] = toSnorm16(position.y);
+            out.Position[2] = toSnorm16(position.z);
+            out.Position[3] = toSnorm16(handedness);
+            octEncode(vertex.Normal, out.Normal);
+            out.TexCoords[0] = toUnorm16(uv.x);
+            out.TexCoords[1] = toUnorm16(uv.y);
+            octEncode(vertex.Tangent, out.Tangent);
+        }
+        return packed;
+    }
+
+    // copies the geometry into the arena, packing it first for MESH_PACKED_VERTICES
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+        GeometryArena &arena = GeometryArena::Instance();
+        GeometryRange range;
+        if (packedVertices)
+        {
+            vector<PackedVertex> packed = packVertices();
+            range = arena.Allocate(VERTEX_FORMAT_PACKED, packed.data(), packed.size(), indices.data(), indices.size());
+        }
+        else
+            range = arena.Allocate(VERTEX_FORMAT_FLOAT, vertices.data(), vertices.size(), indices.data(), indices.size());
+        baseVertex = range.baseVertex;
+        firstIndex = range.firstIndex;
+        indexCount = range.indexCount;
+        VAO = arena.VertexArray(Format());
+        lods.push_back({firstIndex, indexCount});
+    }
+
+    // simplified index buffers after the full one, each level simplifies the previous one. Stops early when
+    // simplifying doesn't gain anything anymore (tiny meshes).
+    void generateLods()
+    {
+        vector<unsigned int> previous = indices;
+        for (unsigned int level = 1; level < MESH_MAX_LODS; level++)
+        {
+            size_t target = (size_t)(indexCount * MESH_LOD_RATIOS[level]) / 3 * 3;
+            vector<unsigned int> simplified = MeshSimplifier::Simplify(vertices, previous, target);
+            if (simplified.empty() || simplified.size() >= previous.size())
+                break;
+            unsigned int first = GeometryArena::Instance().AllocateIndices(Format(), simplified.data(), simplified.size());
+            lods.push_back({first, (unsigned int)simplified.size()});
+            previous.swap(simplified);
+        }
     }
 
 };
@@ -0,0 +1,372 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Binary cache of already imported and flattened model geometry, stored next to the source file as
+// "<source>.meshcache". The file is laid out so it can be mapped and read in place:
+//
+//   MeshCacheHeader
+//   char[header.pathLength]                  source path the cache was built from, padded to 8 bytes
+//   MeshCacheMesh[header.meshCount]
+//   MeshCacheTexture[header.textureCount]
+//   MeshCacheDependency[header.dependencyCount]
+//   char[header.stringsSize]                 texture types and paths, dependency paths
+//   Vertex[] / unsigned int[] per mesh        each array starts on an 8 byte boundary
+//
+// The cache is only used when the magic, version, vertex layout, import flags, source path, mtime and size
+// all match, and the material libraries the source names (the "mtllib" lines of an .obj) still have the mtime
+// and size they had. Anything else means the cache is stale and the model gets imported with Assimp again.
+const uint32_t MESH_CACHE_MAGIC = 0x48534D4C; // "LMSH"
+const uint32_t MESH_CACHE_VERSION = 2;
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t importFlags;
+    int64_t sourceMTime;
+    uint64_t sourceSize;
+    uint32_t pathLength;
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint32_t dependencyCount;
+    uint32_t stringsSize;
+};
+
+struct MeshCacheMesh {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTexture;
+    uint32_t textureCount;
+};
+
+struct MeshCacheTexture {
+    uint32_t typeOffset;
+    uint32_t typeLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+// another file the import read, path relative to the source's directory. A file that didn't exist is recorded
+// with an mtime of -1, so creating it invalidates the cache as well.
+struct MeshCacheDependency {
+    int64_t mtime;
+    uint64_t size;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+class MeshCache
+{
+public:
+    MeshCache() : data(nullptr), size(0) {}
+    ~MeshCache() { Close(); }
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    static string PathFor(const string &sourcePath)
+    {
+        return sourcePath + ".meshcache";
+    }
+
+    // maps the cache of the given source file, returns false if there is no cache or it is stale.
+    bool Open(const string &sourcePath, unsigned int importFlags)
+    {
+        Close();
+        struct stat source;
+        if (stat(sourcePath.c_str(), &source) != 0)
+            return false;
+
+        int fd = open(PathFor(sourcePath).c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat cache;
+        if (fstat(fd, &cache) != 0 || (size_t)cache.st_size < sizeof(MeshCacheHeader))
+        {
+            close(fd);
+            return false;
+        }
+        size = cache.st_size;
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            size = 0;
+            return false;
+        }
+        data = (const char*)mapped;
+
+        if (!isValid(sourcePath, importFlags, source))
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if (data)
+            munmap((void*)data, size);
+        data = nullptr;
+        size = 0;
+    }
+
+    unsigned int MeshCount() const { return header()->meshCount; }
+    const MeshCacheMesh& GetMesh(unsigned int i) const { return meshTable()[i]; }
+
+    const Vertex* Vertices(const MeshCacheMesh &mesh) const
+    {
+        return (const Vertex*)(data + mesh.vertexOffset);
+    }
+    const unsigned int* Indices(const MeshCacheMesh &mesh) const
+    {
+        return (const unsigned int*)(data + mesh.indexOffset);
+    }
+    string TextureType(const MeshCacheMesh &mesh, unsigned int i) const
+    {
+        const MeshCacheTexture &texture = textureTable()[mesh.firstTexture + i];
+        return string(strings() + texture.typeOffset, texture.typeLength);
+    }
+    string TexturePath(const MeshCacheMesh &mesh, unsigned int i) const
+    {
+        const MeshCacheTexture &texture = textureTable()[mesh.firstTexture + i];
+        return string(strings() + texture.pathOffset, texture.pathLength);
+    }
+
+    // writes the cache for the given source file. Writes to a temporary file first so a crash never leaves
+    // a half written cache that would pass validation.
+    static bool Write(const string &sourcePath, unsigned int importFlags, const vector<MeshData> &meshes)
+    {
+        struct stat source;
+        if (stat(sourcePath.c_str(), &source) != 0)
+            return false;
+
+        vector<MeshCacheMesh> meshTable(meshes.size());
+        vector<MeshCacheTexture> textureTable;
+        vector<MeshCacheDependency> dependencyTable;
+        string strings;
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            meshTable[i].vertexCount = meshes[i].vertices.size();
+            meshTable[i].indexCount = meshes[i].indices.size();
+            meshTable[i].firstTexture = textureTable.size();
+            meshTable[i].textureCount = meshes[i].textures.size();
+            for (const MeshTextureRef &texture : meshes[i].textures)
+            {
+                MeshCacheTexture entry;
+                entry.typeOffset = strings.size();
+                entry.typeLength = texture.type.size();
+                strings += texture.type;
+                entry.pathOffset = strings.size();
+                entry.pathLength = texture.path.size();
+                strings += texture.path;
+                textureTable.push_back(entry);
+            }
+        }
+        string directory = directoryOf(sourcePath);
+        for (const string &library : materialLibraries(sourcePath))
+        {
+            MeshCacheDependency entry;
+            statDependency(directory + library, entry);
+            entry.pathOffset = strings.size();
+            entry.pathLength = library.size();
+            strings += library;
+            dependencyTable.push_back(entry);
+        }
+
+        MeshCacheHeader header;
+        header.magic = MESH_CACHE_MAGIC;
+        header.version = MESH_CACHE_VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.importFlags = importFlags;
+        header.sourceMTime = source.st_mtime;
+        header.sourceSize = source.st_size;
+        header.pathLength = sourcePath.size();
+        header.meshCount = meshTable.size();
+        header.textureCount = textureTable.size();
+        header.dependencyCount = dependencyTable.size();
+        header.stringsSize = strings.size();
+
+        // lay out the geometry arrays after the tables
+        uint64_t offset = align(align(sizeof(MeshCacheHeader) + header.pathLength)
+                                + meshTable.size() * sizeof(MeshCacheMesh)
+                                + textureTable.size() * sizeof(MeshCacheTexture)
+                                + dependencyTable.size() * sizeof(MeshCacheDependency)
+                                + strings.size());
+        for (MeshCacheMesh &mesh : meshTable)
+        {
+            mesh.vertexOffset = offset;
+            offset = align(offset + mesh.vertexCount * sizeof(Vertex));
+            mesh.indexOffset = offset;
+            offset = align(offset + mesh.indexCount * sizeof(unsigned int));
+        }
+
+        string cachePath = PathFor(sourcePath);
+        string tempPath = cachePath + ".tmp";
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            cout << "WARNING::MESH_CACHE:: can't write " << cachePath << endl;
+            return false;
+        }
+        out.write((const char*)&header, sizeof(header));
+        out.write(sourcePath.data(), sourcePath.size());
+        pad(out, align(sizeof(MeshCacheHeader) + header.pathLength));
+        out.write((const char*)meshTable.data(), meshTable.size() * sizeof(MeshCacheMesh));
+        out.write((const char*)textureTable.data(), textureTable.size() * sizeof(MeshCacheTexture));
+        out.write((const char*)dependencyTable.data(), dependencyTable.size() * sizeof(MeshCacheDependency));
+        out.write(strings.data(), strings.size());
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            pad(out, meshTable[i].vertexOffset);
+            out.write((const char*)meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+            pad(out, meshTable[i].indexOffset);
+            out.write((const char*)meshes[i].indices.data(), meshes[i].indices.size() * sizeof(unsigned int));
+        }
+        pad(out, offset);
+        out.close();
+        if (!out || std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+        {
+            cout << "WARNING::MESH_CACHE:: can't write " << cachePath << endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const char *data;
+    size_t size;
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + 7) & ~(uint64_t)7;
+    }
+    static void pad(std::ofstream &out, uint64_t offset)
+    {
+        while ((uint64_t)out.tellp() < offset)
+            out.put('\0');
+    }
+
+    const MeshCacheHeader* header() const { return (const MeshCacheHeader*)data; }
+    const char* sourcePath() const { return data + sizeof(MeshCacheHeader); }
+    const MeshCacheMesh* meshTable() const
+    {
+        return (const MeshCacheMesh*)(data + align(sizeof(MeshCacheHeader) + header()->pathLength));
+    }
+    const MeshCacheTexture* textureTable() const
+    {
+        return (const MeshCacheTexture*)(meshTable() + header()->meshCount);
+    }
+    const MeshCacheDependency* dependencyTable() const
+    {
+        return (const MeshCacheDependency*)(textureTable() + header()->textureCount);
+    }
+    const char* strings() const
+    {
+        return (const char*)(dependencyTable() + header()->dependencyCount);
+    }
+
+    // "dir/model.obj" -> "dir/", empty for a file in the working directory
+    static string directoryOf(const string &path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == string::npos ? string() : path.substr(0, slash + 1);
+    }
+
+    // the material libraries an .obj names, like Assimp the rest of an "mtllib" line is a single file name.
+    // Other formats don't name any.
+    static vector<string> materialLibraries(const string &sourcePath)
+    {
+        vector<string> libraries;
+        if (sourcePath.size() < 4 || strcasecmp(sourcePath.c_str() + sourcePath.size() - 4, ".obj") != 0)
+            return libraries;
+        std::ifstream in(sourcePath);
+        string line;
+        while (std::getline(in, line))
+        {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == string::npos || line.compare(start, 6, "mtllib") != 0)
+                continue;
+            size_t nameStart = line.find_first_not_of(" \t", start + 6);
+            size_t nameEnd = line.find_last_not_of(" \t\r");
+            if (nameStart != string::npos && nameStart != start + 6 && nameEnd >= nameStart)
+                libraries.push_back(line.substr(nameStart, nameEnd - nameStart + 1));
+        }
+        return libraries;
+    }
+
+    static void statDependency(const string &path, MeshCacheDependency &dependency)
+    {
+        struct stat file;
+        bool exists = stat(path.c_str(), &file) == 0;
+        dependency.mtime = exists ? (int64_t)file.st_mtime : -1;
+        dependency.size = exists ? (uint64_t)file.st_size : 0;
+    }
+
+    bool isValid(const string &path, unsigned int importFlags, const struct stat &source) const
+    {
+        const MeshCacheHeader *h = header();
+        if (h->magic != MESH_CACHE_MAGIC || h->version != MESH_CACHE_VERSION || h->vertexSize != sizeof(Vertex))
+            return false;
+        if (h->importFlags != importFlags || h->sourceMTime != (int64_t)source.st_mtime
+            || h->sourceSize != (uint64_t)source.st_size)
+            return false;
+        uint64_t tablesEnd = align(sizeof(MeshCacheHeader) + (uint64_t)h->pathLength)
+                             + (uint64_t)h->meshCount * sizeof(MeshCacheMesh)
+                             + (uint64_t)h->textureCount * sizeof(MeshCacheTexture)
+                             + (uint64_t)h->dependencyCount * sizeof(MeshCacheDependency) + h->stringsSize;
+        if (tablesEnd > size || path.compare(0, string::npos, sourcePath(), h->pathLength) != 0)
+            return false;
+        // never trust offsets from disk, a truncated cache must not be read past its end
+        for (unsigned int i = 0; i < h->meshCount; i++)
+        {
+            const MeshCacheMesh &mesh = meshTable()[i];
+            if (mesh.vertexOffset + (uint64_t)mesh.vertexCount * sizeof(Vertex) > size
+                || mesh.indexOffset + (uint64_t)mesh.indexCount * sizeof(unsigned int) > size
+                || (uint64_t)mesh.firstTexture + mesh.textureCount > h->textureCount)
+                return false;
+        }
+        for (unsigned int i = 0; i < h->textureCount; i++)
+        {
+            const MeshCacheTexture &texture = textureTable()[i];
+            if ((uint64_t)texture.typeOffset + texture.typeLength > h->stringsSize
+                || (uint64_t)texture.pathOffset + texture.pathLength > h->stringsSize)
+                return false;
+        }
+        // an edited .mtl changes the texture paths stored above
+        string directory = directoryOf(path);
+        for (unsigned int i = 0; i < h->dependencyCount; i++)
+        {
+            const MeshCacheDependency &dependency = dependencyTable()[i];
+            if ((uint64_t)dependency.pathOffset + dependency.pathLength > h->stringsSize)
+                return false;
+            MeshCacheDependency current;
+            statDependency(directory + string(strings() + dependency.pathOffset, dependency.pathLength), current);
+            if (current.mtime != dependency.mtime || current.size != dependency.size)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
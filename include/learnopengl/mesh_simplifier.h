@@ -0,0 +1,110 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/vertex.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Builds coarser index buffers of a mesh for levels of detail by vertex clustering: the bounding box is cut into a
+// grid, every vertex is snapped to one representative vertex of its cell and the triangles that collapse are
+// dropped. The result indexes the original vertices, so the levels share the mesh's vertex range and only add
+// indices. Crude compared to edge collapse, but fast enough to run on every load and good enough for distant
+// geometry.
+class MeshSimplifier
+{
+public:
+    // index buffer with at most targetIndexCount indices (as close as the grid allows), the original indices
+    // if they're already small enough
+    static std::vector<unsigned int> Simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                                              size_t targetIndexCount)
+    {
+        if (indices.size() <= targetIndexCount || vertices.empty())
+            return indices;
+
+        glm::vec3 boundsMin = vertices[0].Position, boundsMax = vertices[0].Position;
+        for (const Vertex &vertex : vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+
+        // the finest grid that still meets the target, the index count grows with the resolution
+        std::vector<unsigned int> best, result;
+        unsigned int low = 1, high = 256;
+        while (low <= high)
+        {
+            unsigned int resolution = (low + high) / 2;
+            cluster(vertices, indices, boundsMin, boundsMax, resolution, result);
+            if (result.size() <= targetIndexCount)
+            {
+                best.swap(result);
+                low = resolution + 1;
+            }
+            else
+                high = resolution - 1;
+        }
+        return best;
+    }
+
+private:
+    static void cluster(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                        const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, unsigned int resolution,
+                        std::vector<unsigned int> &result)
+    {
+        glm::vec3 cellScale = glm::vec3((float)resolution) / glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+        // per cell the average position, then the vertex closest to it represents the cell
+        std::unordered_map<uint64_t, unsigned int> cells;
+        std::vector<unsigned int> cellOf(vertices.size());
+        std::vector<glm::vec3> sums;
+        std::vector<unsigned int> counts;
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            glm::vec3 cell = glm::min((vertices[i].Position - boundsMin) * cellScale, glm::vec3(resolution - 1.0f));
+            uint64_t key = (uint64_t)cell.x | ((uint64_t)cell.y << 20) | ((uint64_t)cell.z << 40);
+            auto found = cells.find(key);
+            if (found == cells.end())
+            {
+                found = cells.emplace(key, sums.size()).first;
+                sums.push_back(glm::vec3(0.0f));
+                counts.push_back(0);
+            }
+            cellOf[i] = found->second;
+            sums[found->second] += vertices[i].Position;
+            counts[found->second]++;
+        }
+        std::vector<unsigned int> representative(sums.size(), 0);
+        std::vector<float> bestDistance(sums.size(), -1.0f);
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            unsigned int cell = cellOf[i];
+            glm::vec3 offset = vertices[i].Position - sums[cell] / (float)counts[cell];
+            float distance = glm::dot(offset, offset);
+            if (bestDistance[cell] < 0.0f || distance < bestDistance[cell])
+            {
+                bestDistance[cell] = distance;
+                representative[cell] = i;
+            }
+        }
+
+        result.clear();
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            unsigned int a = representative[cellOf[indices[i]]];
+            unsigned int b = representative[cellOf[indices[i + 1]]];
+            unsigned int c = representative[cellOf[indices[i + 2]]];
+            if (a == b || b == c || a == c)
+                continue;
+            result.push_back(a);
+            result.push_back(b);
+            result.push_back(c);
+        }
+    }
+};
+
+#endif
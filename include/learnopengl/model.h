@@ -10,8 +10,12 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/material_table.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
 
 #include <string>
 #include <fstream>
@@ -21,59 +25,186 @@
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
-
+// post processing applied to every imported model, also part of the mesh cache key.
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
 
 
 class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// distinct textures used by the model, it holds one TextureRegistry reference for each of them.
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    string textureNamePrefix;
+    unsigned int meshFlags = 0; // MESH_* flags for every mesh of the model, see mesh.h
+
+    // tag for creating an empty model whose meshes get added later with AddMesh (see AssetManager)
+    struct DeferredLoad {};
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, unsigned int meshFlags = 0)
+        : gammaCorrection(gamma), meshFlags(meshFlags)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
+    Model(string const &path, bool gamma, DeferredLoad) : gammaCorrection(gamma)
+    {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+    }
+
+    // models own their meshes (and OpenGL objects), they can only be moved. Keep them in the AssetManager and
+    // refer to them by handle.
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    Model(Model &&other) noexcept
+        : textures_loaded(std::move(other.textures_loaded)), meshes(std::move(other.meshes)),
+          directory(std::move(other.directory)), gammaCorrection(other.gammaCorrection),
+          textureNamePrefix(std::move(other.textureNamePrefix)), meshFlags(other.meshFlags)
+    {
+        other.textures_loaded.clear();
+        other.meshes.clear();
+    }
+
+    Model& operator=(Model &&other) noexcept
+    {
+        if (this != &other)
+        {
+            releaseTextures();
+            textures_loaded = std::move(other.textures_loaded);
+            other.textures_loaded.clear();
+            meshes = std::move(other.meshes);
+            other.meshes.clear();
+            directory = std::move(other.directory);
+            gammaCorrection = other.gammaCorrection;
+            textureNamePrefix = std::move(other.textureNamePrefix);
+            meshFlags = other.meshFlags;
+        }
+        return *this;
+    }
+
+    ~Model()
+    {
+        releaseTextures();
+    }
+
+    // draws the model, and thus all its meshes. They have the same vertex format so they share one VAO.
     void Draw(Shader &shader)
     {
+        if (meshes.empty())
+            return;
+        glBindVertexArray(meshes[0].VAO);
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            meshes[i].Draw(shader, false);
+        glBindVertexArray(0);
     }
 
     void SetShaderTextureNamePrefix(std::string prefix) {
+        textureNamePrefix = prefix;
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.SetTextureNamePrefix(prefix);
         }
     }
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+
+    // imports a model file into plain CPU side mesh data, straight from the binary mesh cache if it's up to date.
+    // Doesn't touch OpenGL so it can run on a worker thread.
+    static bool ReadModel(string const &path, vector<MeshData> &meshes)
     {
+        // use the binary mesh cache if it's up to date, that way we skip the ASSIMP import entirely
+        MeshCache cache;
+        if (cache.Open(path, MODEL_IMPORT_FLAGS))
+        {
+            readFromCache(cache, meshes);
+            return true;
+        }
+
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
+        }
+
+        // process ASSIMP's root node recursively
+        processNode(scene->mRootNode, scene, meshes);
+
+        // store the flattened meshes so the next start doesn't need ASSIMP
+        MeshCache::Write(path, MODEL_IMPORT_FLAGS, meshes);
+        return true;
+    }
+
+    // uploads an imported mesh, its textures are queued on the TextureRegistry loader. With MESH_MATERIAL_TABLE
+    // the first diffuse and specular textures become a MaterialTable entry instead.
+    void AddMesh(MeshData &&data)
+    {
+        vector<Texture> textures;
+        int materialID = -1;
+        if (meshFlags & MESH_MATERIAL_TABLE)
+            materialID = acquireMaterial(data.textures);
+        else
+            for(const MeshTextureRef &ref : data.textures)
+                textures.push_back(loadTexture(ref.path, ref.type));
+        meshes.emplace_back(std::move(data.vertices), std::move(data.indices), std::move(textures), meshFlags);
+        meshes.back().materialID = materialID;
+        meshes.back().SetTextureNamePrefix(textureNamePrefix);
+    }
+
+private:
+    void releaseTextures()
+    {
+        for (const Texture &texture : textures_loaded)
+            TextureRegistry::Instance().Release(texture.id);
+        textures_loaded.clear();
+        for (Mesh &mesh : meshes)
+        {
+            MaterialTable::Instance().Release(mesh.materialID);
+            mesh.materialID = -1;
         }
+    }
+
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    void loadModel(string const &path)
+    {
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<MeshData> data;
+        if (!ReadModel(path, data))
+            return;
+
+        // images are decoded on worker threads while we build the meshes, uploaded when loading is done
+        for(MeshData &mesh : data)
+            AddMesh(std::move(mesh));
+        TextureRegistry::Instance().Loader().Finish();
+        MaterialTable::Instance().Update();
+    }
+
+    // copies the meshes out of a mapped mesh cache.
+    static void readFromCache(const MeshCache &cache, vector<MeshData> &meshes)
+    {
+        for(unsigned int i = 0; i < cache.MeshCount(); i++)
+        {
+            const MeshCacheMesh &entry = cache.GetMesh(i);
+            const Vertex *vertices = cache.Vertices(entry);
+            const unsigned int *indices = cache.Indices(entry);
+            MeshData mesh;
+            mesh.vertices.assign(vertices, vertices + entry.vertexCount);
+            mesh.indices.assign(indices, indices + entry.indexCount);
+            for(unsigned int j = 0; j < entry.textureCount; j++)
+                mesh.textures.push_back({cache.TextureType(entry, j), cache.TexturePath(entry, j)});
+            meshes.push_back(std::move(mesh));
+        }
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void processNode(aiNode *node, const aiScene *scene, vector<MeshData> &meshes)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -86,18 +217,19 @@ private:
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, meshes);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
-
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
@@ -164,96 +296,64 @@ private:
 
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        collectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data.textures);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        collectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data.textures);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        collectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", data.textures);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
+        collectMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", data.textures);
 
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data, it gets uploaded by AddMesh
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects the paths of all material textures of a given type, they're loaded later by AddMesh.
+    static void collectMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName, vector<MeshTextureRef> &textures)
     {
-        vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            textures.push_back({typeName, str.C_Str()});
         }
-        return textures;
     }
-};
-
-
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    // acquires the model's diffuse/specular pair from the MaterialTable
+    int acquireMaterial(const vector<MeshTextureRef> &textures)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        string diffuse, specular;
+        for (const MeshTextureRef &ref : textures)
+        {
+            if (ref.type == "texture_diffuse" && diffuse.empty())
+                diffuse = this->directory + '/' + ref.path;
+            else if (ref.type == "texture_specular" && specular.empty())
+                specular = this->directory + '/' + ref.path;
+        }
+        return MaterialTable::Instance().Acquire(diffuse, specular, gammaCorrection);
     }
-    else
+
+    // gets the texture at the given path relative to the model directory from the registry, which only loads it
+    // if no model did so before.
+    Texture loadTexture(string const &path, string const &typeName)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        TextureRegistry &registry = TextureRegistry::Instance();
+        unsigned int id = registry.Acquire(this->directory + '/' + path, gammaCorrection);
+        // the model keeps a single reference per distinct texture
+        for(unsigned int j = 0; j < textures_loaded.size(); j++)
+        {
+            if(textures_loaded[j].id == id)
+            {
+                registry.Release(id);
+                return textures_loaded[j];
+            }
+        }
+        Texture texture;
+        texture.id = id;
+        texture.type = typeName;
+        texture.path = path;
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
     }
-
-    return textureID;
-}
+};
 #endif
@@ -0,0 +1,37 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// Counter based random numbers (Philox4x32-10, Salmon et al. 2011). There is no generator state: the numbers are a
+// pure function of a 128 bit counter and a 64 bit key (the seed), so any element of a sequence can be computed on
+// its own, in any order and on any thread, and a seed always gives the same numbers.
+struct Philox4x32 {
+    uint32_t v[4];
+
+    Philox4x32(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t seed)
+    {
+        uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+        v[0] = c0; v[1] = c1; v[2] = c2; v[3] = c3;
+        for (int round = 0; round < 10; round++)
+        {
+            if (round > 0)
+            {
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+            uint64_t product0 = (uint64_t)0xD2511F53u * v[0];
+            uint64_t product1 = (uint64_t)0xCD9E8D57u * v[2];
+            uint32_t c1Next = v[1], c3Next = v[3];
+            v[0] = (uint32_t)(product1 >> 32) ^ c1Next ^ k0;
+            v[1] = (uint32_t)product1;
+            v[2] = (uint32_t)(product0 >> 32) ^ c3Next ^ k1;
+            v[3] = (uint32_t)product0;
+        }
+    }
+
+    // the i-th number as a float in [0, 1)
+    float Unit(int i) const { return (v[i] >> 8) * (1.0f / 16777216.0f); }
+};
+
+#endif
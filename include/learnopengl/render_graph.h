@@ -0,0 +1,470 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <vector>
+
+typedef unsigned int RenderResource;
+
+// size and format of a texture the graph allocates
+struct RenderTextureDesc {
+    int width;
+    int height;
+    GLenum internalFormat;
+
+    bool operator==(const RenderTextureDesc &other) const
+    {
+        return width == other.width && height == other.height && internalFormat == other.internalFormat;
+    }
+};
+
+// A frame described as passes that declare the textures they read and write, rebuilt every frame from whatever
+// settings are on. Execute() works out what actually has to run:
+// - passes are culled when nothing that ends up on screen depends on what they write, so a pass only has to be
+//   declared, never switched off by hand
+// - color outputs nobody reads aren't allocated and their draw buffer is GL_NONE (a shader may still write them)
+// - the textures only exist between the pass writing them and the last pass reading them, textures of the same
+//   size and format whose lifetimes don't overlap share the same GL texture, and GL textures that no pass needed
+//   in a frame are deleted
+// so the memory and bandwidth of the frame follow the settings that are on. Passes run in the order they were
+// added; a pass reads what earlier passes wrote.
+// Depth outputs are always attached, the pass writing them depth tests against them. Imported textures are owned
+// by someone else and the passes writing them bind their own framebuffers; for every other pass the graph binds a
+// framebuffer with its outputs and sets the viewport to their size before calling it.
+// Declaring a frame reuses the pass and resource storage of the frames before, names are string literals. What's
+// left per frame is the PassFunctions: a lambda capturing more than a couple of pointers doesn't fit in
+// std::function's small buffer and gets a heap allocation of its own, a handful per frame.
+class RenderGraph
+{
+public:
+    typedef std::function<void(const RenderGraph&)> PassFunction;
+
+    // declares what a pass reads and writes, color outputs take the attachments (and fragment outputs) in order
+    class PassBuilder
+    {
+    public:
+        PassBuilder(RenderGraph &graph, unsigned int pass) : graph(graph), pass(pass) {}
+        PassBuilder& Read(RenderResource resource)
+        {
+            graph.passes[pass].reads.push_back(resource);
+            return *this;
+        }
+        PassBuilder& Write(RenderResource resource)
+        {
+            graph.passes[pass].writes.push_back(resource);
+            graph.resources[resource].producer = pass;
+            return *this;
+        }
+        PassBuilder& WriteDepth(RenderResource resource)
+        {
+            graph.passes[pass].depth = resource;
+            graph.resources[resource].producer = pass;
+            return *this;
+        }
+    private:
+        RenderGraph &graph;
+        unsigned int pass;
+    };
+
+    RenderGraph() = default;
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // forgets the passes and resources of the last frame, the GL textures stay around for the next Execute
+    void Reset()
+    {
+        passCount = 0;
+        // 0 is "no resource"
+        resourceCount = 1;
+    }
+
+    RenderResource CreateTexture(const char *name, const RenderTextureDesc &desc)
+    {
+        Resource &resource = addResource(name);
+        resource.desc = desc;
+        return resourceCount - 1;
+    }
+
+    // a texture owned outside of the graph
+    RenderResource ImportTexture(const char *name, unsigned int texture)
+    {
+        Resource &resource = addResource(name);
+        resource.imported = true;
+        resource.texture = texture;
+        return resourceCount - 1;
+    }
+
+    // the default framebuffer, the passes writing it are the ones everything else is kept for
+    RenderResource ImportBackbuffer(int width, int height)
+    {
+        Resource &resource = addResource("backbuffer");
+        resource.desc = {width, height, GL_NONE};
+        resource.backbuffer = true;
+        return resourceCount - 1;
+    }
+
+    PassBuilder AddPass(const char *name, PassFunction execute)
+    {
+        if (passCount == passes.size())
+            passes.emplace_back();
+        Pass &pass = passes[passCount++];
+        pass.name = name;
+        pass.execute = std::move(execute);
+        pass.reads.clear();
+        pass.writes.clear();
+        pass.depth = 0;
+        pass.viewportWidth = pass.viewportHeight = 0;
+        return PassBuilder(*this, passCount - 1);
+    }
+
+    // culls, allocates and runs the passes. Leaves the default framebuffer bound.
+    void Execute()
+    {
+        compile();
+        for (unsigned int i = 0; i < passCount; i++)
+        {
+            const Pass &pass = passes[i];
+            if (!pass.live)
+                continue;
+            if (!pass.framebufferKey.empty() || pass.writesBackbuffer)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, pass.writesBackbuffer ? 0 : framebufferFor(pass.framebufferKey, pass.depthAttachment));
+                if (!pass.writesBackbuffer)
+                    glDrawBuffers(pass.drawBuffers.size(), pass.drawBuffers.data());
+                glViewport(0, 0, pass.viewportWidth, pass.viewportHeight);
+            }
+            pass.execute(*this);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // the GL texture of a resource, for the passes to sample their inputs
+    unsigned int Texture(RenderResource resource) const
+    {
+        const Resource &r = resources[resource];
+        return r.imported ? r.texture : r.physical >= 0 ? pool[r.physical].texture : 0;
+    }
+
+    // a framebuffer with just the resource's texture attached, e.g. to blit from it
+    unsigned int ReadFramebuffer(RenderResource resource)
+    {
+        return framebufferFor({Texture(resource)}, GL_NONE);
+    }
+
+    // statistics of the last Execute
+    unsigned int DeclaredPasses() const { return passCount; }
+    unsigned int LivePasses() const { return livePasses; }
+    unsigned int AllocatedTextures() const { return pool.size(); }
+    size_t AllocatedBytes() const
+    {
+        size_t bytes = 0;
+        for (const PhysicalTexture &texture : pool)
+            bytes += (size_t)texture.desc.width * texture.desc.height * bytesPerPixel(texture.desc.internalFormat);
+        return bytes;
+    }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        for (PhysicalTexture &texture : pool)
+            glDeleteTextures(1, &texture.texture);
+        pool.clear();
+        for (auto &entry : framebuffers)
+            glDeleteFramebuffers(1, &entry.second);
+        framebuffers.clear();
+    }
+
+private:
+    struct Resource {
+        const char *name = "";
+        RenderTextureDesc desc = {0, 0, GL_NONE};
+        bool imported = false;
+        bool backbuffer = false;
+        unsigned int texture = 0;   // imported ones
+        int producer = -1;
+        bool needed = false;
+        int lastUse = -1;
+        int physical = -1;
+    };
+    struct Pass {
+        const char *name = "";
+        PassFunction execute;
+        std::vector<RenderResource> reads;
+        std::vector<RenderResource> writes;
+        RenderResource depth = 0;
+        // filled in by compile
+        bool live = false;
+        bool writesBackbuffer = false;
+        std::vector<unsigned int> framebufferKey;   // color attachment textures, 0 for the unused ones
+        GLenum depthAttachment = GL_NONE;
+        std::vector<GLenum> drawBuffers;
+        int viewportWidth = 0;
+        int viewportHeight = 0;
+    };
+    struct PhysicalTexture {
+        RenderTextureDesc desc;
+        unsigned int texture;
+        int busyUntil;      // last pass using it this frame
+        bool used;
+    };
+
+    // only the first passCount/resourceCount entries belong to the frame being declared, the rest are kept for
+    // the next frames so their vectors keep their capacity
+    std::vector<Pass> passes;
+    std::vector<Resource> resources = std::vector<Resource>(1);
+    unsigned int passCount = 0;
+    unsigned int resourceCount = 1;
+    std::vector<PhysicalTexture> pool;
+    // by color attachments plus the depth texture at the end
+    std::map<std::vector<unsigned int>, unsigned int> framebuffers;
+    unsigned int livePasses = 0;
+
+    void compile()
+    {
+        // walk back from the backbuffer: a pass is live if a live pass after it reads what it writes
+        livePasses = 0;
+        for (int i = passCount - 1; i >= 0; i--)
+        {
+            Pass &pass = passes[i];
+            pass.live = false;
+            pass.writesBackbuffer = false;
+            for (RenderResource resource : pass.writes)
+            {
+                if (resources[resource].backbuffer)
+                    pass.writesBackbuffer = true;
+                if (resources[resource].backbuffer || resources[resource].needed)
+                    pass.live = true;
+            }
+            if (!pass.live)
+                continue;
+            livePasses++;
+            for (RenderResource resource : pass.reads)
+            {
+                resources[resource].needed = true;
+                resources[resource].lastUse = std::max(resources[resource].lastUse, i);
+            }
+            // a depth target is also tested against by every pass attaching it, it has to live until the last one
+            if (pass.depth)
+            {
+                resources[pass.depth].needed = true;
+                resources[pass.depth].lastUse = std::max(resources[pass.depth].lastUse, i);
+            }
+        }
+
+        // hand out the pool's textures, a texture is free again after the last pass reading what it holds
+        for (PhysicalTexture &texture : pool)
+        {
+            texture.busyUntil = -1;
+            texture.used = false;
+        }
+        for (int i = 0; i < (int)passCount; i++)
+        {
+            Pass &pass = passes[i];
+            if (!pass.live)
+                continue;
+            for (RenderResource resource : pass.writes)
+                allocate(resource, i);
+            if (pass.depth)
+                allocate(pass.depth, i);
+        }
+        releaseUnused();
+
+        for (unsigned int i = 0; i < passCount; i++)
+        {
+            Pass &pass = passes[i];
+            if (!pass.live)
+                continue;
+            pass.framebufferKey.clear();
+            pass.drawBuffers.clear();
+            pass.depthAttachment = GL_NONE;
+            const RenderTextureDesc *size = nullptr;
+            for (unsigned int slot = 0; slot < pass.writes.size(); slot++)
+            {
+                const Resource &resource = resources[pass.writes[slot]];
+                if (resource.backbuffer)
+                    size = &resource.desc;
+                if (resource.imported || resource.backbuffer)
+                    continue;
+                bool attached = resource.needed && resource.physical >= 0;
+                pass.framebufferKey.resize(slot + 1, 0);
+                pass.drawBuffers.resize(slot + 1, GL_NONE);
+                if (attached)
+                {
+                    pass.framebufferKey[slot] = pool[resource.physical].texture;
+                    pass.drawBuffers[slot] = GL_COLOR_ATTACHMENT0 + slot;
+                    size = &resource.desc;
+                }
+            }
+            if (pass.depth)
+            {
+                const Resource &resource = resources[pass.depth];
+                if (pass.framebufferKey.empty())
+                    pass.framebufferKey.push_back(0);
+                pass.framebufferKey.push_back(pool[resource.physical].texture);
+                pass.depthAttachment = depthAttachmentFor(resource.desc.internalFormat);
+                size = &resource.desc;
+            }
+            if (size)
+            {
+                pass.viewportWidth = size->width;
+                pass.viewportHeight = size->height;
+            }
+        }
+    }
+
+    Resource& addResource(const char *name)
+    {
+        if (resourceCount == resources.size())
+            resources.emplace_back();
+        Resource &resource = resources[resourceCount++];
+        resource = Resource();
+        resource.name = name;
+        return resource;
+    }
+
+    void allocate(RenderResource handle, int pass)
+    {
+        Resource &resource = resources[handle];
+        if (resource.imported || resource.backbuffer || !resource.needed || resource.physical >= 0)
+            return;
+        int lastUse = std::max(resource.lastUse, pass);
+        for (unsigned int i = 0; i < pool.size(); i++)
+        {
+            if (pool[i].desc == resource.desc && pool[i].busyUntil < pass)
+            {
+                resource.physical = i;
+                pool[i].busyUntil = lastUse;
+                pool[i].used = true;
+                return;
+            }
+        }
+        PhysicalTexture texture;
+        texture.desc = resource.desc;
+        texture.busyUntil = lastUse;
+        texture.used = true;
+        texture.texture = createTexture(resource.desc);
+        pool.push_back(texture);
+        resource.physical = pool.size() - 1;
+    }
+
+    // deletes the textures no pass needed this frame, with the framebuffers they were attached to
+    void releaseUnused()
+    {
+        bool allUsed = true;
+        for (const PhysicalTexture &texture : pool)
+            allUsed = allUsed && texture.used;
+        if (allUsed)
+            return;
+        std::vector<int> remap(pool.size(), -1);
+        std::vector<PhysicalTexture> kept;
+        for (unsigned int i = 0; i < pool.size(); i++)
+        {
+            if (pool[i].used)
+            {
+                remap[i] = kept.size();
+                kept.push_back(pool[i]);
+                continue;
+            }
+            for (auto it = framebuffers.begin(); it != framebuffers.end();)
+            {
+                bool attached = false;
+                for (unsigned int texture : it->first)
+                    attached = attached || texture == pool[i].texture;
+                if (attached)
+                {
+                    glDeleteFramebuffers(1, &it->second);
+                    it = framebuffers.erase(it);
+                }
+                else
+                    ++it;
+            }
+            glDeleteTextures(1, &pool[i].texture);
+        }
+        pool.swap(kept);
+        for (unsigned int i = 0; i < resourceCount; i++)
+            if (resources[i].physical >= 0)
+                resources[i].physical = remap[resources[i].physical];
+    }
+
+    unsigned int framebufferFor(const std::vector<unsigned int> &key, GLenum depthAttachment)
+    {
+        auto found = framebuffers.find(key);
+        if (found != framebuffers.end())
+            return found->second;
+        unsigned int framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        unsigned int colorCount = depthAttachment == GL_NONE ? key.size() : key.size() - 1;
+        for (unsigned int slot = 0; slot < colorCount; slot++)
+            if (key[slot])
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + slot, GL_TEXTURE_2D, key[slot], 0);
+        if (depthAttachment != GL_NONE)
+            glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, key.back(), 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::RENDER_GRAPH::Framebuffer is not complete!" << std::endl;
+        framebuffers[key] = framebuffer;
+        return framebuffer;
+    }
+
+    static bool isDepthFormat(GLenum internalFormat)
+    {
+        return internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8 ||
+               internalFormat == GL_DEPTH_COMPONENT16 || internalFormat == GL_DEPTH_COMPONENT24 ||
+               internalFormat == GL_DEPTH_COMPONENT32F;
+    }
+
+    static GLenum depthAttachmentFor(GLenum internalFormat)
+    {
+        return internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8
+               ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+    }
+
+    static unsigned int bytesPerPixel(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_RGBA32F: return 16;
+        case GL_RGBA16F: case GL_DEPTH32F_STENCIL8: return 8;
+        case GL_DEPTH_COMPONENT16: return 2;
+        default: return 4;
+        }
+    }
+
+    static unsigned int createTexture(const RenderTextureDesc &desc)
+    {
+        bool depth = isDepthFormat(desc.internalFormat);
+        GLenum format = GL_RGBA, type = GL_FLOAT;
+        if (desc.internalFormat == GL_DEPTH24_STENCIL8)
+        {
+            format = GL_DEPTH_STENCIL;
+            type = GL_UNSIGNED_INT_24_8;
+        }
+        else if (desc.internalFormat == GL_DEPTH32F_STENCIL8)
+        {
+            format = GL_DEPTH_STENCIL;
+            type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+        }
+        else if (depth)
+            format = GL_DEPTH_COMPONENT;
+
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, format, type, NULL);
+        // depth is only ever read texel by texel
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+        // clamp, filters sampling around a texel would otherwise pick up the other side of the image
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+};
+
+#endif
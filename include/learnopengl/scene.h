@@ -0,0 +1,118 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/asset_manager.h>
+#include <learnopengl/batch_renderer.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+typedef unsigned int RenderObjectHandle;
+
+// a mesh switches to its next level of detail once its bounding sphere's radius over the distance to the viewer
+// (about half the fraction of the screen height it covers at a 45 degree fov) drops below these
+const float SCENE_LOD_SIZES[MESH_MAX_LODS - 1] = {0.15f, 0.05f};
+
+// one placement of a model in the world
+struct RenderObject {
+    ModelHandle model;
+    glm::mat4 transform;
+    bool visible;
+};
+
+// The things drawn every frame. Objects refer to their model by handle, the models themselves stay in the
+// AssetManager, so placing a model several times or drawing it every frame never touches its meshes.
+class Scene
+{
+public:
+    explicit Scene(AssetManager &assets) : assets(assets) {}
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    RenderObjectHandle Add(ModelHandle model, const glm::mat4 &transform = glm::mat4(1.0f))
+    {
+        objects.push_back({model, transform, true});
+        return objects.size() - 1;
+    }
+
+    RenderObject& Get(RenderObjectHandle handle) { return objects[handle]; }
+
+    void SetTransform(RenderObjectHandle handle, const glm::mat4 &transform) { objects[handle].transform = transform; }
+
+    // draws the visible objects with the (already active) shader through the batch renderer, so every mesh is
+    // a single instanced draw no matter how many objects use it. Meshes outside of the frustum are skipped, first
+    // by their bounding sphere and then by their box, the others are drawn at a level of detail picked by their
+    // size seen from viewPosition. Models that are still streaming in draw whatever meshes they already have.
+    void Draw(Shader &shader, BatchRenderer &batch, const Frustum &frustum, const glm::vec3 &viewPosition)
+    {
+        visibleMeshes = culledMeshes = 0;
+        std::fill(lodMeshes, lodMeshes + MESH_MAX_LODS, 0u);
+        for (const RenderObject &object : objects)
+        {
+            if (!object.visible)
+                continue;
+            const glm::mat4 &transform = object.transform;
+            glm::vec3 axisX(transform[0]), axisY(transform[1]), axisZ(transform[2]);
+            float scale = std::max(glm::length(axisX), std::max(glm::length(axisY), glm::length(axisZ)));
+            glm::vec3 absX = glm::abs(axisX), absY = glm::abs(axisY), absZ = glm::abs(axisZ);
+
+            int matrix = -1;
+            for (const Mesh &mesh : assets.GetModel(object.model).meshes)
+            {
+                glm::vec3 sphereCenter(transform * glm::vec4(mesh.sphereCenter, 1.0f));
+                bool inside = frustum.IntersectsSphere(sphereCenter, mesh.sphereRadius * scale);
+                if (inside)
+                {
+                    // world space box around the transformed box
+                    glm::vec3 extents = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+                    glm::vec3 boxCenter(transform * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+                    inside = frustum.IntersectsBox(boxCenter, absX * extents.x + absY * extents.y + absZ * extents.z);
+                }
+                if (!inside)
+                {
+                    culledMeshes++;
+                    continue;
+                }
+                if (matrix < 0)
+                    matrix = batch.AddTransform(transform);
+                unsigned int lod = std::min(selectLod(mesh.sphereRadius * scale, sphereCenter, viewPosition),
+                                            mesh.LodCount() - 1);
+                batch.SubmitMesh(mesh, matrix, lod);
+                visibleMeshes++;
+                lodMeshes[lod]++;
+            }
+        }
+        batch.Flush(shader);
+    }
+
+    // meshes drawn and skipped by the last Draw
+    unsigned int VisibleMeshes() const { return visibleMeshes; }
+    unsigned int CulledMeshes() const { return culledMeshes; }
+    // meshes the last Draw drew at a level of detail
+    unsigned int LodMeshes(unsigned int lod) const { return lodMeshes[lod]; }
+
+private:
+    AssetManager &assets;
+    std::vector<RenderObject> objects;
+    unsigned int visibleMeshes = 0;
+    unsigned int culledMeshes = 0;
+    unsigned int lodMeshes[MESH_MAX_LODS] = {};
+
+    static unsigned int selectLod(float radius, const glm::vec3 &center, const glm::vec3 &viewPosition)
+    {
+        float distance = glm::length(center - viewPosition);
+        unsigned int lod = 0;
+        while (lod < MESH_MAX_LODS - 1 && radius < SCENE_LOD_SIZES[lod] * distance)
+            lod++;
+        return lod;
+    }
+};
+
+#endif
@@ -5,17 +5,26 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <common.h>
+
+// (name, value) pairs put in front of every stage of a program as "#define name value", so one source file can be
+// compiled into variants that leave out what they don't need at compile time instead of branching per pixel
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
 class Shader
 {
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr,
+           const ShaderDefines &defines = ShaderDefines())
     {
         std::string vertexPathString(vertexPath);
         std::string fragmentPathString(fragmentPath);
@@ -64,6 +73,13 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        if (!defines.empty())
+        {
+            vertexCode = injectDefines(vertexCode, defines);
+            fragmentCode = injectDefines(fragmentCode, defines);
+            if (geometryPath != nullptr)
+                geometryCode = injectDefines(geometryCode, defines);
+        }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -101,7 +117,41 @@ public:
         glDeleteShader(fragment);
         if(geometryPath != nullptr)
             glDeleteShader(geometry);
-
+        reflectUniforms();
+    }
+    // transform feedback program without a fragment stage: the vertex (and optional geometry) shader outputs
+    // named in feedbackVaryings are captured interleaved into the buffer bound to GL_TRANSFORM_FEEDBACK_BUFFER.
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* geometryPath, const std::vector<const char*> &feedbackVaryings)
+    {
+        std::string vertexCode = readFile(vertexPath);
+        unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+        const char* vShaderCode = vertexCode.c_str();
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        unsigned int geometry = 0;
+        if(geometryPath != nullptr)
+        {
+            std::string geometryCode = readFile(geometryPath);
+            const char* gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        if(geometry)
+            glAttachShader(ID, geometry);
+        // has to be set before linking
+        glTransformFeedbackVaryings(ID, feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(vertex);
+        if(geometry)
+            glDeleteShader(geometry);
+        reflectUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -113,62 +163,188 @@ public:
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(Location(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(Location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(Location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(Location(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(Location(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(Location(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(Location(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(Location(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(Location(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(Location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(Location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(Location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // attaches the uniform block to a binding point (see uniform_buffer.h), does nothing if the program
+    // doesn't use the block.
+    // ------------------------------------------------------------------------
+    void BindUniformBlock(const std::string &blockName, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, blockName.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+
+    // uniform locations are looked up once after linking, Location() is just a hash map lookup (-1 when the
+    // uniform doesn't exist or was optimized away, which glUniform* silently ignores). Resolve the locations
+    // you set every frame once and use the GLint overloads below to skip the lookup entirely.
+    // ------------------------------------------------------------------------
+    GLint Location(const std::string &name) const
+    {
+        auto found = uniformLocations.find(name);
+        return found != uniformLocations.end() ? found->second : -1;
+    }
+    // ------------------------------------------------------------------------
+    void setBool(GLint location, bool value) const
+    {
+        glUniform1i(location, (int)value);
+    }
+    void setInt(GLint location, int value) const
+    {
+        glUniform1i(location, value);
+    }
+    void setFloat(GLint location, float value) const
+    {
+        glUniform1f(location, value);
+    }
+    void setVec2(GLint location, const glm::vec2 &value) const
+    {
+        glUniform2fv(location, 1, &value[0]);
+    }
+    void setVec3(GLint location, const glm::vec3 &value) const
+    {
+        glUniform3fv(location, 1, &value[0]);
+    }
+    void setVec4(GLint location, const glm::vec4 &value) const
+    {
+        glUniform4fv(location, 1, &value[0]);
+    }
+    void setMat2(GLint location, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(GLint location, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(GLint location, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    // records the location of every active uniform. Arrays are reported once as "name[0]", so every element
+    // (and the bare array name) gets its own entry; arrays of structs are already reported per member.
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        uniformLocations.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::string buffer(maxLength > 0 ? maxLength : 1, '\0');
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &buffer[0]);
+            std::string name(buffer.c_str(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            if (location < 0) // uniform block members
+                continue;
+            uniformLocations[name] = location;
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                uniformLocations[base] = location;
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniformLocations[elementName] = glGetUniformLocation(ID, elementName.c_str());
+                }
+            }
+        }
+    }
+
+    static std::string readFile(const char* path)
+    {
+        std::ifstream file;
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            return stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        }
+        return std::string();
+    }
+
+    // the defines have to follow the #version line, which has to come first
+    static std::string injectDefines(const std::string &code, const ShaderDefines &defines)
+    {
+        std::string lines;
+        for (const auto &define : defines)
+            lines += "#define " + define.first + " " + define.second + "\n";
+        size_t version = code.find("#version");
+        if (version == std::string::npos)
+            return lines + code;
+        size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return code + "\n" + lines;
+        return code.substr(0, lineEnd + 1) + lines + code.substr(lineEnd + 1);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -195,4 +371,46 @@ private:
         }
     }
 };
+
+// The variants of one vertex/fragment shader pair, each compiled the first time its defines are asked for and kept
+// for every later Get() with the same defines (in the same order). Picking the variant on the CPU replaces uniform
+// branches that every pixel would otherwise pay for.
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(const char* vertexPath, const char* fragmentPath)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath)
+    {
+    }
+
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    Shader& Get(const ShaderDefines &defines)
+    {
+        std::string key;
+        for (const auto &define : defines)
+            key += define.first + "=" + define.second + ";";
+        auto found = variants.find(key);
+        if (found == variants.end())
+            found = variants.emplace(key, Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, defines)).first;
+        return found->second;
+    }
+
+    // how many variants have been compiled so far
+    unsigned int Count() const { return variants.size(); }
+
+    // has to happen while the GL context is still alive
+    void Delete()
+    {
+        for (auto &variant : variants)
+            glDeleteProgram(variant.second.ID);
+        variants.clear();
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::unordered_map<std::string, Shader> variants;
+};
 #endif
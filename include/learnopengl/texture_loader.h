@@ -0,0 +1,364 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/dds.h>
+#include <learnopengl/thread_pool.h>
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// S3TC formats come from EXT_texture_compression_s3tc and EXT_texture_sRGB, our glad loader is plain 3.3 core
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// pixels decoded by stb_image, or a whole baked .dds file, owned until uploaded
+struct DecodedImage {
+    unsigned char *data = nullptr;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    // set for block compressed images, data then holds the file and its mip levels start at dataOffset
+    DDSFormat compressed = DDS_UNKNOWN;
+    uint32_t mipCount = 0;
+    size_t dataOffset = 0;
+};
+
+inline void FreeImage(DecodedImage &image)
+{
+    if (image.compressed != DDS_UNKNOWN)
+        free(image.data);
+    else
+        stbi_image_free(image.data);
+    image.data = nullptr;
+}
+
+// reads the .dds texture_baker wrote for the source image, as long as it isn't older than the source.
+inline bool ReadBakedImage(const std::string &filename, DecodedImage &image)
+{
+    std::string bakedPath = BakedTexturePath(filename);
+    struct stat source, baked;
+    if (stat(bakedPath.c_str(), &baked) != 0 || (stat(filename.c_str(), &source) == 0 && baked.st_mtime < source.st_mtime))
+        return false;
+    FILE *file = fopen(bakedPath.c_str(), "rb");
+    if (!file)
+        return false;
+    unsigned char *data = (unsigned char*)malloc(baked.st_size);
+    size_t size = data ? fread(data, 1, baked.st_size, file) : 0;
+    fclose(file);
+
+    uint32_t width, height;
+    // nothing samples two channel textures (no shader rebuilds a normal's z), BC5 files from older bakes are
+    // skipped and the source is decoded instead
+    if (!data || !ParseDDS(data, size, image.compressed, width, height, image.mipCount, image.dataOffset)
+        || image.compressed == DDS_BC5)
+    {
+        free(data);
+        image.compressed = DDS_UNKNOWN;
+        return false;
+    }
+    image.data = data;
+    image.width = width;
+    image.height = height;
+    image.components = image.compressed == DDS_BC3 ? 4 : 3;
+    return true;
+}
+
+inline DecodedImage DecodeImage(const std::string &filename, bool useBaked = false)
+{
+    DecodedImage image;
+    // prefer the pre-mipmapped, block compressed version, that skips both the decode and mipmap generation
+    if (useBaked && ReadBakedImage(filename, image))
+        return image;
+    image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+    return image;
+}
+
+inline GLenum CompressedInternalFormat(DDSFormat format, bool gamma)
+{
+    switch (format) {
+        case DDS_BC1: return gamma ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        default: return gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+}
+
+// S3TC is an extension in GL 3.3 (supported by every desktop driver, but we still check)
+inline bool SupportsS3TC()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+        if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_EXT_texture_compression_s3tc") == 0)
+            return true;
+    return false;
+}
+
+inline GLenum FormatForComponents(int components)
+{
+    if (components == 1)
+        return GL_RED;
+    else if (components == 3)
+        return GL_RGB;
+    return GL_RGBA;
+}
+
+// gamma corrected (sRGB) images are stored in an sRGB internal format so sampling returns linear values
+inline GLenum InternalFormatForComponents(int components, bool gamma)
+{
+    if (gamma && components == 3)
+        return GL_SRGB;
+    else if (gamma && components == 4)
+        return GL_SRGB_ALPHA;
+    return FormatForComponents(components);
+}
+
+// Decodes images on the worker pool while the GL thread keeps going. Load/LoadCubemap hand out the texture
+// name right away, filled with a 1x1 placeholder so it can be drawn with immediately. Finish() then uploads
+// every image as soon as its decode is done, or Update() streams them in a few per frame through a pixel
+// buffer object.
+class TextureLoader
+{
+public:
+    TextureLoader() : pbo(0), useBaked(-1) {}
+    ~TextureLoader()
+    {
+        // no OpenGL here, the context may already be gone. Just wait for the decodes and drop them.
+        for (PendingImage &job : pending)
+        {
+            DecodedImage image = job.image.get();
+            FreeImage(image);
+        }
+    }
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    unsigned int Load(const std::string &filename, bool gamma = false)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        uploadPlaceholder(GL_TEXTURE_2D);
+
+        queue(textureID, GL_TEXTURE_2D, GL_TEXTURE_2D, filename, gamma);
+        return textureID;
+    }
+
+    unsigned int LoadCubemap(const std::vector<std::string> &faces)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+        for (unsigned int i = 0; i < faces.size(); i++)
+            uploadPlaceholder(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
+        for (unsigned int i = 0; i < faces.size(); i++)
+            queue(textureID, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, faces[i], false);
+        return textureID;
+    }
+
+    // uploads all queued images, in the order their decodes finish.
+    void Finish()
+    {
+        while (!pending.empty())
+        {
+            bool uploaded = false;
+            for (unsigned int i = 0; i < pending.size(); i++)
+            {
+                if (pending[i].image.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                {
+                    upload(pending[i]);
+                    pending.erase(pending.begin() + i);
+                    uploaded = true;
+                    break;
+                }
+            }
+            // nothing done yet, block on the oldest job instead of spinning
+            if (!uploaded)
+                pending.front().image.wait();
+        }
+    }
+
+    // uploads the images whose decode is already done, until roughly uploadBudget bytes went up (always at least
+    // one image so a big one can't stall forever). Never blocks, returns the number of bytes uploaded.
+    size_t Update(size_t uploadBudget)
+    {
+        size_t uploaded = 0;
+        for (unsigned int i = 0; i < pending.size() && uploaded < uploadBudget;)
+        {
+            if (pending[i].image.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                uploaded += upload(pending[i], true);
+                pending.erase(pending.begin() + i);
+            }
+            else
+                i++;
+        }
+        // streaming is over, the pixel buffer isn't needed anymore
+        if (pending.empty() && pbo)
+        {
+            glDeleteBuffers(1, &pbo);
+            pbo = 0;
+        }
+        return uploaded;
+    }
+
+    bool Idle() const { return pending.empty(); }
+
+    bool IsPending(unsigned int id) const
+    {
+        for (const PendingImage &job : pending)
+            if (job.id == id)
+                return true;
+        return false;
+    }
+
+    // drops the queued images of a texture that's about to be deleted, so nothing gets uploaded into a stale name.
+    void Cancel(unsigned int id)
+    {
+        for (unsigned int i = 0; i < pending.size();)
+        {
+            if (pending[i].id == id)
+            {
+                DecodedImage image = pending[i].image.get();
+                FreeImage(image);
+                pending.erase(pending.begin() + i);
+            }
+            else
+                i++;
+        }
+    }
+
+private:
+    struct PendingImage {
+        unsigned int id;
+        GLenum bindTarget;
+        GLenum imageTarget;
+        bool gamma;
+        std::string filename;
+        std::future<DecodedImage> image;
+    };
+    std::vector<PendingImage> pending;
+    unsigned int pbo;
+    int useBaked;   // whether baked .dds files can be used, -1 until checked on the GL thread
+
+    // mid grey texel shown until the real image arrives
+    static void uploadPlaceholder(GLenum imageTarget)
+    {
+        const unsigned char grey[4] = {128, 128, 128, 255};
+        glTexImage2D(imageTarget, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    }
+
+    void queue(unsigned int id, GLenum bindTarget, GLenum imageTarget, const std::string &filename, bool gamma)
+    {
+        PendingImage job;
+        job.id = id;
+        job.bindTarget = bindTarget;
+        job.imageTarget = imageTarget;
+        job.gamma = gamma;
+        job.filename = filename;
+        if (useBaked < 0)
+            useBaked = SupportsS3TC();
+        bool baked = useBaked;
+        job.image = ThreadPool::Workers().Submit([filename, baked] { return DecodeImage(filename, baked); });
+        pending.push_back(std::move(job));
+    }
+
+    size_t upload(PendingImage &job, bool streaming = false)
+    {
+        DecodedImage image = job.image.get();
+        if (!image.data)
+        {
+            std::cout << "Texture failed to load at path: " << job.filename << std::endl;
+            return 0;
+        }
+        GLenum format = FormatForComponents(image.components);
+        size_t size = (size_t)image.width * image.height * image.components;
+        const unsigned char *pixels = image.data;
+        if (image.compressed != DDS_UNKNOWN)
+        {
+            pixels += image.dataOffset;
+            size = 0;
+            uint32_t w = image.width, h = image.height;
+            for (uint32_t level = 0; level < image.mipCount; level++, w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1)
+                size += DDSLevelSize(image.compressed, w, h);
+        }
+        // when streaming, copy into an orphaned pixel buffer so the driver can do the transfer asynchronously
+        // instead of stalling the frame on a client memory read
+        if (streaming)
+        {
+            if (!pbo)
+                glGenBuffers(1, &pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (mapped)
+            {
+                memcpy(mapped, pixels, size);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                pixels = nullptr; // offset 0 into the bound buffer
+            }
+            else
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(job.bindTarget, job.id);
+        if (image.compressed != DDS_UNKNOWN)
+        {
+            // every mip level is already in the file, no runtime generation needed
+            GLenum internalFormat = CompressedInternalFormat(image.compressed, job.gamma);
+            uint32_t w = image.width, h = image.height;
+            for (uint32_t level = 0; level < image.mipCount; level++)
+            {
+                size_t levelSize = DDSLevelSize(image.compressed, w, h);
+                glCompressedTexImage2D(job.imageTarget, level, internalFormat, w, h, 0, levelSize, pixels);
+                pixels += levelSize;
+                w = w > 1 ? w / 2 : 1;
+                h = h > 1 ? h / 2 : 1;
+            }
+            glTexParameteri(job.bindTarget, GL_TEXTURE_MAX_LEVEL, image.mipCount - 1);
+        }
+        else
+        {
+            glTexImage2D(job.imageTarget, 0, InternalFormatForComponents(image.components, job.gamma),
+                         image.width, image.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+            if (job.bindTarget == GL_TEXTURE_2D)
+                glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        FreeImage(image);
+        return size;
+    }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/texture_loader.h>
+
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// Process wide, reference counted set of the 2D textures loaded from files. Textures are keyed by their canonical
+// absolute path and gamma flag, so every model referencing the same image shares a single decode and upload.
+// All the images go through one TextureLoader: Loader().Finish() waits for them, Loader().Update() streams them.
+class TextureRegistry
+{
+public:
+    static TextureRegistry& Instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    TextureRegistry(const TextureRegistry&) = delete;
+    TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+    TextureLoader& Loader() { return loader; }
+
+    // returns the texture for the file, queuing its load if it isn't resident yet. Every Acquire (and Retain)
+    // has to be matched by a Release.
+    unsigned int Acquire(const std::string &filename, bool gamma = false)
+    {
+        Key key = {CanonicalPath(filename), gamma};
+        auto found = ids.find(key);
+        if (found != ids.end())
+        {
+            textures[found->second].references++;
+            return found->second;
+        }
+        unsigned int id = loader.Load(filename, gamma);
+        ids[key] = id;
+        textures[id] = {key, 1};
+        return id;
+    }
+
+    void Retain(unsigned int id)
+    {
+        auto found = textures.find(id);
+        if (found != textures.end())
+            found->second.references++;
+    }
+
+    // drops a reference, the texture is deleted once nobody uses it anymore.
+    void Release(unsigned int id)
+    {
+        auto found = textures.find(id);
+        if (found == textures.end())
+            return;
+        if (--found->second.references > 0)
+            return;
+        loader.Cancel(id);
+        glDeleteTextures(1, &id);
+        ids.erase(found->second.key);
+        textures.erase(found);
+    }
+
+    unsigned int Size() const { return textures.size(); }
+
+    static std::string CanonicalPath(const std::string &filename)
+    {
+        char *resolved = realpath(filename.c_str(), nullptr);
+        if (!resolved)
+            return filename;
+        std::string path(resolved);
+        free(resolved);
+        return path;
+    }
+
+private:
+    struct Key {
+        std::string path;
+        bool gamma;
+
+        bool operator==(const Key &other) const { return gamma == other.gamma && path == other.path; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const { return std::hash<std::string>()(key.path) * 2 + key.gamma; }
+    };
+    struct Entry {
+        Key key;
+        unsigned int references;
+    };
+
+    std::unordered_map<Key, unsigned int, KeyHash> ids;
+    std::unordered_map<unsigned int, Entry> textures;
+    TextureLoader loader;
+
+    TextureRegistry() = default;
+};
+
+#endif
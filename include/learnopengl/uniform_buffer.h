@@ -0,0 +1,96 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Per frame data shared by all the programs through std140 uniform blocks. Every program declaring a block
+// gets it attached to the same binding point (Shader::BindUniformBlock), so the data is written once per frame
+// instead of being set on every program with separate glUniform* calls.
+// The structs below mirror the GLSL declarations byte for byte: a vec3 takes 16 bytes in std140, so every
+// vec3 is followed by a float that either carries data or pads it.
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+const GLuint MATERIALS_BLOCK_BINDING = 2;
+
+const unsigned int POINT_LIGHT_COUNT = 5;
+const unsigned int MAX_MATERIALS = 256;
+
+// layout (std140) uniform Camera
+struct CameraBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    float padding;
+};
+
+struct DirLightBlock {
+    glm::vec3 direction;
+    float padding0;
+    glm::vec3 ambient;
+    float padding1;
+    glm::vec3 diffuse;
+    float padding2;
+    glm::vec3 specular;
+    float padding3;
+};
+
+struct PointLightBlock {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float padding;
+};
+
+// layout (std140) uniform Lights
+struct LightsBlock {
+    DirLightBlock dirLight;
+    PointLightBlock pointLights[POINT_LIGHT_COUNT];
+};
+
+// layout (std140) uniform Materials, written by the MaterialTable. x and y are the diffuse and specular array
+// layers of the material, -1 when it has none (or it isn't loaded yet).
+struct MaterialsBlock {
+    glm::ivec4 materials[MAX_MATERIALS];
+};
+
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock doesn't match the std140 layout");
+static_assert(sizeof(LightsBlock) == 64 * (1 + POINT_LIGHT_COUNT), "LightsBlock doesn't match the std140 layout");
+static_assert(sizeof(MaterialsBlock) == 16 * MAX_MATERIALS, "MaterialsBlock doesn't match the std140 layout");
+
+// GL buffer holding one Block, attached to its binding point for its whole lifetime.
+template <typename Block>
+class UniformBuffer
+{
+public:
+    unsigned int ID;
+
+    explicit UniformBuffer(GLuint binding)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    }
+
+    // uploads the whole block in one call
+    void Update(const Block &block)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void Delete()
+    {
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+    }
+};
+
+#endif
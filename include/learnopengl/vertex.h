@@ -0,0 +1,32 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+};
+
+// compact vertex layout for MESH_PACKED_VERTICES meshes, 20 bytes instead of 56. Positions and UVs are
+// normalized to the mesh's bounds and UV range (decoded with Mesh::positionOffset/Scale, uvOffset/Scale),
+// normals and tangents are octahedral encoded and the bitangent is rebuilt from them and the sign in Position[3].
+struct PackedVertex {
+    int16_t  Position[4];   // snorm16
+    int16_t  Normal[2];     // snorm16 octahedral
+    uint16_t TexCoords[2];  // unorm16
+    int16_t  Tangent[2];    // snorm16 octahedral
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex isn't tightly packed");
+
+#endif
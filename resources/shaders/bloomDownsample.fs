@@ -0,0 +1,48 @@
+#version 330 core
+// 13 tap downsample of the level above (Jimenez 2014): five overlapping 2x2 boxes, the center one weighted most
+out vec3 downsample;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform bool karisAverage;  // first level only, tames single very bright pixels
+
+vec3 tap(float x, float y, vec2 texel)
+{
+    return texture(source, TexCoords + vec2(x, y) * texel).rgb;
+}
+
+// the weight of a box in the Karis average
+float karisWeight(vec3 color)
+{
+    return 1.0 / (1.0 + dot(color, vec3(0.2126, 0.7152, 0.0722)));
+}
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(source, 0));
+    vec3 a = tap(-2.0,  2.0, texel), b = tap(0.0,  2.0, texel), c = tap(2.0,  2.0, texel);
+    vec3 d = tap(-2.0,  0.0, texel), e = tap(0.0,  0.0, texel), f = tap(2.0,  0.0, texel);
+    vec3 g = tap(-2.0, -2.0, texel), h = tap(0.0, -2.0, texel), i = tap(2.0, -2.0, texel);
+    vec3 j = tap(-1.0,  1.0, texel), k = tap(1.0,  1.0, texel);
+    vec3 l = tap(-1.0, -1.0, texel), m = tap(1.0, -1.0, texel);
+
+    vec3 boxes[5] = vec3[](
+        (j + k + l + m) * 0.25,
+        (a + b + d + e) * 0.25,
+        (b + c + e + f) * 0.25,
+        (d + e + g + h) * 0.25,
+        (e + f + h + i) * 0.25
+    );
+    float weights[5] = float[](0.5, 0.125, 0.125, 0.125, 0.125);
+
+    vec3 result = vec3(0.0);
+    float total = 0.0;
+    for (int n = 0; n < 5; n++)
+    {
+        float weight = weights[n] * (karisAverage ? karisWeight(boxes[n]) : 1.0);
+        result += boxes[n] * weight;
+        total += weight;
+    }
+    downsample = max(result / total, vec3(0.0));
+}
@@ -0,0 +1,21 @@
+#version 330 core
+// 3x3 tent filter upsample of the level below, blended additively onto this level
+out vec3 upsample;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+
+vec3 tap(float x, float y, vec2 texel)
+{
+    return texture(source, TexCoords + vec2(x, y) * texel).rgb;
+}
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(source, 0));
+    vec3 result = tap(0.0, 0.0, texel) * 4.0;
+    result += (tap(0.0, 1.0, texel) + tap(-1.0, 0.0, texel) + tap(1.0, 0.0, texel) + tap(0.0, -1.0, texel)) * 2.0;
+    result += tap(-1.0, 1.0, texel) + tap(1.0, 1.0, texel) + tap(-1.0, -1.0, texel) + tap(1.0, -1.0, texel);
+    upsample = result / 16.0;
+}
@@ -0,0 +1,28 @@
+#version 330 core
+// one level of the depth pyramid: the farthest depth of the 2x2 texels below, 3 wide at the end of odd rows and
+// columns so no texel of the level below is left out
+out float depth;
+
+uniform sampler2D source;   // the depth buffer or the previous level, the only level visible is the one to read
+
+float fetch(ivec2 texel, ivec2 size)
+{
+    return texelFetch(source, min(texel, size - 1), 0).r;
+}
+
+void main()
+{
+    ivec2 size = textureSize(source, 0);
+    ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+    float farthest = max(max(fetch(base, size), fetch(base + ivec2(1, 0), size)),
+                         max(fetch(base + ivec2(0, 1), size), fetch(base + ivec2(1, 1), size)));
+    bool extraColumn = base.x + 3 == size.x;
+    bool extraRow = base.y + 3 == size.y;
+    if (extraColumn)
+        farthest = max(farthest, max(fetch(base + ivec2(2, 0), size), fetch(base + ivec2(2, 1), size)));
+    if (extraRow)
+        farthest = max(farthest, max(fetch(base + ivec2(0, 2), size), fetch(base + ivec2(1, 2), size)));
+    if (extraColumn && extraRow)
+        farthest = max(farthest, fetch(base + ivec2(2, 2), size));
+    depth = farthest;
+}
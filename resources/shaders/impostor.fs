@@ -0,0 +1,15 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D impostor;
+
+void main()
+{
+    vec4 color = texture(impostor, TexCoords);
+    // the background the impostor was baked on
+    if (color.a < 0.5)
+        discard;
+    FragColor = color;
+}
@@ -0,0 +1,34 @@
+#version 330 core
+// one camera facing quad per CloudInstance, corners from gl_VertexID (triangle strip of 4)
+layout (location = 3) in vec4 instancePositionScale;
+layout (location = 4) in vec4 instanceRotation;
+
+out vec2 TexCoords;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+uniform vec4 boundingSphere;    // object space center and radius the impostor was baked with
+
+// rotates v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    float scale = instancePositionScale.w;
+    vec3 center = instancePositionScale.xyz + rotate(instanceRotation, boundingSphere.xyz * scale);
+    float radius = boundingSphere.w * scale;
+    // the camera's right and up axes are the first two rows of the view matrix
+    vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+    vec2 offset = (corner * 2.0 - 1.0) * radius;
+    gl_Position = projection * view * vec4(center + right * offset.x + up * offset.y, 1.0);
+    TexCoords = corner;
+}
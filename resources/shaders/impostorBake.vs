@@ -0,0 +1,14 @@
+#version 330 core
+// draws the model once, in object space, for its impostor texture (see impostor.h)
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+uniform mat4 viewProjection;
+
+void main()
+{
+    gl_Position = viewProjection * vec4(aPos, 1.0);
+    TexCoords = aTexCoords;
+}
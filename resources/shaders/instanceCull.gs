@@ -0,0 +1,21 @@
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec4 vPositionScale[];
+in vec4 vRotation[];
+flat in int vVisible[];
+
+// captured by transform feedback, the visible instances end up packed one after the other
+out vec4 culledPositionScale;
+out vec4 culledRotation;
+
+void main()
+{
+    if (vVisible[0] == 0)
+        return;
+    culledPositionScale = vPositionScale[0];
+    culledRotation = vRotation[0];
+    EmitVertex();
+    EndPrimitive();
+}
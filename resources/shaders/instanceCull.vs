@@ -0,0 +1,90 @@
+#version 330 core
+// one point per instance, the geometry shader passes the visible ones on to transform feedback
+layout (location = 0) in vec4 instancePositionScale;
+layout (location = 1) in vec4 instanceRotation;
+
+out vec4 vPositionScale;
+out vec4 vRotation;
+flat out int vVisible;
+
+uniform vec4 frustumPlanes[6];  // normalized, pointing inwards (see frustum.h)
+uniform vec4 boundingSphere;    // object space center and radius of the model
+uniform vec3 viewPosition;
+uniform vec2 distanceRange;     // the bucket being culled keeps instances from x (inclusive) to y
+
+// occlusion culling against a depth pyramid (see depth_pyramid.h)
+uniform bool occlusionCulling;
+uniform sampler2D depthPyramid;
+uniform int pyramidLevels;
+uniform mat4 occlusionViewProjection;   // what the depth buffer of the pyramid was drawn with
+uniform float occlusionMargin;          // NDC units added to every side of the tested rectangle
+
+// rotates v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+float farthestDepth(ivec2 texelMin, ivec2 texelMax, int level)
+{
+    return max(max(texelFetch(depthPyramid, texelMin, level).r, texelFetch(depthPyramid, ivec2(texelMax.x, texelMin.y), level).r),
+               max(texelFetch(depthPyramid, ivec2(texelMin.x, texelMax.y), level).r, texelFetch(depthPyramid, texelMax, level).r));
+}
+
+// true when the sphere is certainly behind what the depth pyramid holds. Spheres that cross the near plane or
+// leave the screen aren't tested, the pyramid knows nothing about what's there.
+bool occluded(vec3 center, float radius)
+{
+    vec3 ndcMin = vec3(1e30), ndcMax = vec3(-1e30);
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = occlusionViewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+    // the result is drawn a frame later, whatever the view turns in between must not uncover an instance culled here
+    ndcMin.xy -= occlusionMargin;
+    ndcMax.xy += occlusionMargin;
+    if (any(lessThan(ndcMin.xy, vec2(-1.0))) || any(greaterThan(ndcMax.xy, vec2(1.0))))
+        return false;
+
+    // the level where the screen rectangle covers at most 2x2 texels, one more if rounding made it 3
+    vec2 uvMin = ndcMin.xy * 0.5 + 0.5, uvMax = ndcMax.xy * 0.5 + 0.5;
+    vec2 extent = (uvMax - uvMin) * vec2(textureSize(depthPyramid, 0));
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, pyramidLevels - 1);
+    ivec2 size = textureSize(depthPyramid, level);
+    ivec2 texelMin = clamp(ivec2(uvMin * vec2(size)), ivec2(0), size - 1);
+    ivec2 texelMax = clamp(ivec2(uvMax * vec2(size)), ivec2(0), size - 1);
+    if (any(greaterThan(texelMax - texelMin, ivec2(1))) && level < pyramidLevels - 1)
+    {
+        level++;
+        size = textureSize(depthPyramid, level);
+        texelMin = clamp(ivec2(uvMin * vec2(size)), ivec2(0), size - 1);
+        texelMax = clamp(ivec2(uvMax * vec2(size)), ivec2(0), size - 1);
+    }
+    // nearest depth of the sphere's box against the farthest occluder in front of it
+    return ndcMin.z * 0.5 + 0.5 > farthestDepth(texelMin, texelMax, level);
+}
+
+void main()
+{
+    float scale = instancePositionScale.w;
+    vec3 center = instancePositionScale.xyz + rotate(instanceRotation, boundingSphere.xyz * scale);
+    float radius = boundingSphere.w * scale;
+
+    vVisible = 1;
+    for (int i = 0; i < 6; i++)
+        if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+            vVisible = 0;
+    float distance = length(center - viewPosition);
+    if (distance < distanceRange.x || distance >= distanceRange.y)
+        vVisible = 0;
+    if (vVisible == 1 && occlusionCulling && occluded(center, radius))
+        vVisible = 0;
+    vPositionScale = instancePositionScale;
+    vRotation = instanceRotation;
+}
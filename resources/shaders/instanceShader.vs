@@ -1,15 +1,27 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in mat4 instanceMatrix;
+// CloudInstance: position and uniform scale, rotation quaternion
+layout (location = 3) in vec4 instancePositionScale;
+layout (location = 4) in vec4 instanceRotation;
 
 out vec2 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// rotates v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main()
 {
-    gl_Position = projection * view * instanceMatrix * vec4(aPos, 1.0);
+    vec3 worldPos = instancePositionScale.xyz + rotate(instanceRotation, aPos * instancePositionScale.w);
+    gl_Position = projection * view * vec4(worldPos, 1.0);
     TexCoords = aTexCoords;
 }
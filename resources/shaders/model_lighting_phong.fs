@@ -3,24 +3,28 @@
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BrightColor;
 
+// DirLight and PointLight live in the Lights uniform block, their std140 layout is mirrored by
+// DirLightBlock and PointLightBlock in uniform_buffer.h
 struct DirLight {
     vec3 direction;
-
+    float padding0;
     vec3 ambient;
+    float padding1;
     vec3 diffuse;
+    float padding2;
     vec3 specular;
+    float padding3;
 };
 
 struct PointLight {
     vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
     float constant;
+    vec3 ambient;
     float linear;
+    vec3 diffuse;
     float quadratic;
+    vec3 specular;
+    float padding;
 };
 
 struct SpotLight {
@@ -39,9 +43,6 @@ struct SpotLight {
 };
 
 struct Material {
-    sampler2D diffuse;
-    sampler2D specular;
-
     float shininess;
 };
 
@@ -51,14 +52,35 @@ in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
 
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+};
+
+// filled by the MaterialTable (MaterialsBlock in uniform_buffer.h): x is the layer of diffuseLayers, y the layer
+// of specularLayers, -1 for none
+#define MAX_MATERIALS 256
+layout (std140) uniform Materials {
+    ivec4 materials[MAX_MATERIALS];
+};
+
+uniform sampler2DArray diffuseLayers;
+uniform sampler2DArray specularLayers;
+uniform int materialID;
 
 uniform Material material;
-uniform vec3 viewPosition;
 uniform samplerCube skybox;
 uniform bool blinn;
 
+// the material's colors at this fragment, sampled once in main
+vec3 diffuseColor;
+vec3 specularColor;
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
@@ -66,6 +88,11 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {
+    ivec4 layers = materials[materialID];
+    // grey like the texture placeholder until the diffuse layer is there, no specular without a specular map
+    diffuseColor = layers.x < 0 ? vec3(0.5) : texture(diffuseLayers, vec3(TexCoords, layers.x)).rgb;
+    specularColor = layers.y < 0 ? vec3(0.0) : texture(specularLayers, vec3(TexCoords, layers.y)).rgb;
+
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
     vec3 result = CalcDirLight(dirLight, normal, viewDir);
@@ -92,9 +119,9 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
     return (ambient + diffuse + specular);
 }
 
@@ -117,9 +144,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords).xxx);
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor.xxx;
     //vec3 cuberef = vec3(texture(skybox, reflectDir).rgb);
     ambient *= attenuation;
     diffuse *= attenuation;
@@ -145,9 +172,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
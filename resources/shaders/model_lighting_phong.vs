@@ -1,5 +1,5 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
@@ -7,14 +7,46 @@ out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// model matrices of the batched draws (see BatchRenderer), one matrix is 4 texels (columns)
+uniform samplerBuffer modelMatrices;
+uniform int instanceOffset;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// meshes uploaded with MESH_PACKED_VERTICES (see PackedVertex in mesh.h) store positions and uvs normalized
+// to the mesh's bounds and uv range and octahedral encoded normals. Float meshes get an identity decode.
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform vec2 uvOffset;
+uniform vec2 uvScale;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+mat4 modelMatrix()
+{
+    int base = (instanceOffset + gl_InstanceID) * 4;
+    return mat4(texelFetch(modelMatrices, base), texelFetch(modelMatrices, base + 1),
+                texelFetch(modelMatrices, base + 2), texelFetch(modelMatrices, base + 3));
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = aNormal;
-    TexCoords = aTexCoords;
+    mat4 model = modelMatrix();
+    vec3 position = aPos.xyz * positionScale + positionOffset;
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = packedVertices ? octDecode(aNormal.xy) : aNormal;
+    TexCoords = aTexCoords * uvScale + uvOffset;
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}
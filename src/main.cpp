@@ -13,6 +13,18 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/asset_manager.h>
+#include <learnopengl/bloom.h>
+#include <learnopengl/cloud_field.h>
+#include <learnopengl/depth_pyramid.h>
+#include <learnopengl/dynamic_resolution.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/gaussian_kernel.h>
+#include <learnopengl/impostor.h>
+#include <learnopengl/instance_culler.h>
+#include <learnopengl/render_graph.h>
+#include <learnopengl/scene.h>
+#include <learnopengl/uniform_buffer.h>
 
 #include <iostream>
 
@@ -26,9 +38,7 @@ void processInput(GLFWwindow *window);
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
-unsigned int loadCubemap(vector<std::string> faces);
-
-void setLights(Shader lightingShader, glm::vec3 pointLightPositions[]);
+void setLights(LightsBlock &lights, glm::vec3 pointLightPositions[]);
 
 void renderQuad();
 
@@ -83,6 +93,23 @@ struct ProgramState {
     float hdrGamma = 2.2f;
     int effectSelected = 0;
     bool bloom = false;
+    int bloomMode = 0;  // 0 mip chain, 1 gaussian ping-pong
+    int blurRadius = 4; // of the gaussian, in texels
+    bool occlusionCulling = true;
+    bool dynamicResolution = true;
+    float targetFrameMs = 16.0f; // GPU time the dynamic resolution aims for
+    // per frame statistics, not saved
+    unsigned int visibleMeshes = 0;
+    unsigned int culledMeshes = 0;
+    unsigned int visibleClouds = 0;
+    unsigned int lodMeshes[MESH_MAX_LODS] = {};
+    unsigned int lodClouds[MESH_MAX_LODS] = {};
+    unsigned int livePasses = 0;
+    unsigned int declaredPasses = 0;
+    unsigned int renderTargets = 0;
+    size_t renderTargetBytes = 0;
+    float renderScale = 1.0f;
+    float gpuFrameMs = 0.0f;
 
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
@@ -121,7 +148,9 @@ void ProgramState::SaveToFile(std::string filename) {
             << dirLightSpecular.x << '\n' << dirLightSpecular.y << '\n' << dirLightSpecular.z << '\n'
             << pointLightAmbient.x << '\n' << pointLightAmbient.y << '\n' << pointLightAmbient.z << '\n'
             << pointLightDiffuse.x << '\n' << pointLightDiffuse.y << '\n' << pointLightDiffuse.z << '\n'
-            << pointLightSpecular.x << '\n' << pointLightSpecular.y << '\n' << pointLightSpecular.z;
+            << pointLightSpecular.x << '\n' << pointLightSpecular.y << '\n' << pointLightSpecular.z << '\n'
+            << bloomMode << '\n'
+            << blurRadius;
 }
 void ProgramState::LoadFromFile(std::string filename) {
     std::ifstream in(filename);
@@ -153,7 +182,9 @@ void ProgramState::LoadFromFile(std::string filename) {
                 >> dirLightSpecular.x >> dirLightSpecular.y >> dirLightSpecular.z
                 >> pointLightAmbient.x >> pointLightAmbient.y >> pointLightAmbient.z
                 >> pointLightDiffuse.x >> pointLightDiffuse.y >> pointLightDiffuse.z
-                >> pointLightSpecular.x >> pointLightSpecular.y >> pointLightSpecular.z;
+                >> pointLightSpecular.x >> pointLightSpecular.y >> pointLightSpecular.z
+                >> bloomMode
+                >> blurRadius;
 
     }
 }
@@ -163,9 +194,20 @@ void ProgramState::UpdateRatio(int width, int height){
 }
 ProgramState *programState;
 
-void drawTrees(Shader modelShader, Model treeModel);
-void drawSnail(Shader modelShader, Model snailModel);
-void drawIsland(Shader modelShader, Model islandModel);
+const unsigned int TREE_COUNT = 3;
+// extra field of view (degrees) the clouds are culled with, covers the frame the culling result lags behind
+const float CLOUD_CULL_FOV_MARGIN = 10.0f;
+// the cloud field only depends on this, the same seed always gives the same sky
+const uint64_t CLOUD_SEED = 0x5EED0C10D5ull;
+// distances where clouds switch from the full mesh to the simplified one and from that to impostors
+const std::vector<float> CLOUD_LOD_DISTANCES = {20.0f, 45.0f};
+const unsigned int CLOUD_IMPOSTOR_BUCKET = 2;
+
+glm::mat4 treeTransform(unsigned int tree);
+glm::mat4 snailTransform();
+glm::mat4 islandTransform();
+
+unsigned int setupCloudInstancing(unsigned int instanceBuffer);
 
 void DrawImGui(ProgramState *programState);
 
@@ -209,6 +251,10 @@ int main() {
 
     programState = new ProgramState;
     programState->LoadFromFile("resources/program_state.txt");
+    // the saved size is whatever the window had last time, the render targets follow the one it has now
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    programState->UpdateRatio(framebufferWidth, framebufferHeight);
     if (programState->ImGuiEnabled) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
@@ -234,22 +280,46 @@ int main() {
 
     // build and compile shaders
     // -------------------------
-    Shader screenShader("resources/shaders/framebuffer.vs", "resources/shaders/framebuffer.fs");
+    // a variant per effect, HDR and bloom, compiled when a combination is first shown
+    ShaderPermutations screenShaders("resources/shaders/framebuffer.vs", "resources/shaders/framebuffer.fs");
     Shader ourShader("resources/shaders/model_lighting_phong.vs", "resources/shaders/model_lighting_phong.fs");
     Shader skyboxShader("resources/shaders/skyboxShader.vs", "resources/shaders/skyboxShader.fs");
     Shader instanceShader("resources/shaders/instanceShader.vs", "resources/shaders/instanceShader.fs");
     Shader blurShader("resources/shaders/blur.vs", "resources/shaders/blur.fs");
 
+    // camera and light data is shared by all the programs through uniform blocks, updated once per frame
+    UniformBuffer<CameraBlock> cameraBuffer(CAMERA_BLOCK_BINDING);
+    UniformBuffer<LightsBlock> lightsBuffer(LIGHTS_BLOCK_BINDING);
+    for (Shader *shader : {&ourShader, &skyboxShader, &instanceShader}) {
+        shader->BindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+        shader->BindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+    }
+    ourShader.BindUniformBlock("Materials", MATERIALS_BLOCK_BINDING);
+    CameraBlock camera = {};
+    LightsBlock lights = {};
+
     // load models
     // -----------
-    Model islandModel("resources/objects/island/land/island.obj");
-    islandModel.SetShaderTextureNamePrefix("material.");
-    Model snailModel("resources/objects/island/snail/snail.obj");
-    snailModel.SetShaderTextureNamePrefix("material.");
-    Model treeModel("resources/objects/island/tree/tree.obj");
-    treeModel.SetShaderTextureNamePrefix("material.");
-    Model cloudModel("resources/objects/cloud/cloud.obj");
-    cloudModel.SetShaderTextureNamePrefix("material.");
+    // the asset manager returns right away, models and textures stream in over the first frames
+    AssetManager assets;
+    // the lit models use the compact vertex format and the material table, the clouds keep float vertices and
+    // plain textures for the instancing shader. The small models and the clouds get simplified levels of detail.
+    const unsigned int litMeshFlags = MESH_PACKED_VERTICES | MESH_MATERIAL_TABLE;
+    ModelHandle islandModel = assets.LoadModel("resources/objects/island/land/island.obj", "material.", false, litMeshFlags);
+    ModelHandle snailModel = assets.LoadModel("resources/objects/island/snail/snail.obj", "material.", false,
+                                              litMeshFlags | MESH_GENERATE_LODS);
+    ModelHandle treeModel = assets.LoadModel("resources/objects/island/tree/tree.obj", "material.", false,
+                                             litMeshFlags | MESH_GENERATE_LODS);
+    ModelHandle cloudModel = assets.LoadModel("resources/objects/cloud/cloud.obj", "material.", false, MESH_GENERATE_LODS);
+
+    // place the models, transforms are updated every frame since the island can be moved through ImGui
+    Scene scene(assets);
+    BatchRenderer batch;
+    RenderObjectHandle islandObject = scene.Add(islandModel);
+    RenderObjectHandle snailObject = scene.Add(snailModel);
+    RenderObjectHandle treeObjects[TREE_COUNT];
+    for (unsigned int i = 0; i < TREE_COUNT; i++)
+        treeObjects[i] = scene.Add(treeModel);
 
     float skyboxVertices[] = {
             // positions
@@ -313,64 +383,21 @@ int main() {
             1.0f,  1.0f,  1.0f, 1.0f
     };
     // -------------- INSTANCING -------------
-    // generate a large list of semi-random model transformation matrices
-    // ------------------------------------------------------------------
-    unsigned int amount = 1000;
-    glm::mat4* modelMatrices;
-    modelMatrices = new glm::mat4[amount];
-    srand(glfwGetTime()); // initialize random seed
-    float radius = 20.0f;
-    float offset = 25.0f;
-    for (unsigned int i = 0; i < amount; i++)
-    {
-        glm::mat4 model = glm::mat4(1.0f);
-        // 1. translation: position the clouds to the right area
-        if(i < amount/2)
-            model = glm::translate(model, glm::vec3(rand() % 100 - 50, 6 + rand() % 10, rand() % 100 - 50));
-        else
-            model = glm::translate(model, glm::vec3(rand() % 100 - 50, -4 - rand() % 10, rand() % 100 - 50));
-
-        // 2. scale: Scale between 0.1f and 0.3f
-        float scale = (rand() % 20) / 100.0f + 0.1f;
-        model = glm::scale(model, glm::vec3(scale));
-        // 3. rotation: add random rotation around a (semi)randomly picked rotation axis vector
-        float rotAngle = (rand() % 60);
-        model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
-        // 4. now add to list of matrices
-        modelMatrices[i] = model;
-    }
-    // configure instanced array
-    // -------------------------
-    unsigned int buffer;
-    glGenBuffers(1, &buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
-
-    // set transformation matrices as an instance vertex attribute (with divisor 1)
-    // note: we're cheating a little by taking the, now publicly declared, VAO of the model's mesh(es) and adding new vertexAttribPointers
-    // normally you'd want to do this in a more organized fashion, but for learning purposes this will do.
-    // -----------------------------------------------------------------------------------------------------------------------------------
-    for (unsigned int i = 0; i < cloudModel.meshes.size(); i++)
-    {
-        unsigned int VAO = cloudModel.meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
-    }
+    // the cloud field streams in chunks of clouds around the camera (generated on the worker threads), they're
+    // culled on the GPU every frame and sorted into a bucket per level of detail, each drawn from the culler's
+    // output with one VAO per output buffer. The near buckets draw the cloud mesh's levels of detail, the far one
+    // impostors
+    CloudField cloudField(CLOUD_SEED);
+    InstanceCuller cloudCuller(cloudField.InstanceBuffer(), cloudField.Capacity(), CLOUD_LOD_DISTANCES);
+    std::vector<InstanceRange> cloudRanges;
+    Impostor cloudImpostor;
+    unsigned int cloudVAOs[MESH_MAX_LODS][2];
+    for (unsigned int bucket = 0; bucket < cloudCuller.BucketCount(); bucket++)
+        for (unsigned int i = 0; i < 2; i++)
+            cloudVAOs[bucket][i] = bucket == CLOUD_IMPOSTOR_BUCKET
+                                   ? Impostor::CreateVertexArray(cloudCuller.OutputBuffer(bucket, i))
+                                   : setupCloudInstancing(cloudCuller.OutputBuffer(bucket, i));
+
     // -------------- ----------- -------------
 
     // Culling
@@ -415,60 +442,18 @@ int main() {
             FileSystem::getPath("resources/textures/skybox/space/back.png")
     };
 
-    unsigned int cubemapTexture = loadCubemap(faces);
-
-    // framebuffer configuration
-    // -------------------------
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-    // create 2 floating point color buffers (1 for normal rendering, other for brightness threshold values)
-    unsigned int colorBuffers[2];
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // attach texture to framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
-
-     // create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT); // use a single renderbuffer object for both a depth AND stencil buffer.
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo); // now actually attach it
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-    // now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "ERROR::FRAMEBUFFER:: RBO Framebuffer is not complete!" << endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // ping-pong-framebuffer for blurring
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongColorbuffers[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-        // also check if framebuffers are complete (no need for depth buffer)
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "ERROR::FRAMEBUFFER:: Pingpong Framebuffer not complete!" << std::endl;
-    }
+    unsigned int cubemapTexture = assets.LoadCubemap(faces);
+
+    // render targets
+    // --------------
+    // the scene, blur and composite targets are declared every frame in a render graph, so only the ones the current
+    // settings need exist. They follow the size of the window's framebuffer, scaled down by the dynamic resolution;
+    // the composite pass stretches the scene back over the whole window
+    RenderGraph renderGraph;
+    DynamicResolution dynamicResolution(programState->targetFrameMs);
+    DepthPyramid depthPyramid(programState->screenWidth, programState->screenHeight);
+    // the default bloom, blurs over a chain of ever smaller targets instead of the ping-pong framebuffers
+    MipChainBloom mipChainBloom(programState->screenWidth, programState->screenHeight);
     // --------------------------------------------------------
 
 
@@ -476,10 +461,15 @@ int main() {
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
     ourShader.use();
-    ourShader.setInt("material.diffuse", 0);
-    ourShader.setInt("material.specular", 1);
+    ourShader.setInt("diffuseLayers", 0);
+    ourShader.setInt("specularLayers", 1);
     blurShader.use();
     blurShader.setInt("image", 0);
+    // the kernel only changes with the radius, the uniforms are set again when it does
+    int blurKernelRadius = -1;
+    // the composite variant in use, looked up again only when the settings it was picked for change
+    Shader *screenShader = nullptr;
+    int screenVariant = -1;
 
 
     // render loop
@@ -491,117 +481,247 @@ int main() {
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // upload whatever finished loading since the last frame
+        assets.Update();
+
         // input
         // -----
         processInput(window);
 
-        // draw in wireframe
-        if(programState->wireframe)
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        else
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-        // bind to framebuffer and draw scene as we normally would to color texture
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-        glEnable(GL_DEPTH_TEST);
-        // make sure we clear the framebuffer's content
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-
-        // render
-        // ------
-        glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-
-        // Skybox shader set
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        glm::mat4 view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // Draw skybox
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
-
-        // don't forget to enable shader before setting uniforms
-        ourShader.use();
-        ourShader.setBool("blinn", programState->blinnLighting);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setFloat("material.shininess", 30.0f);
-        // view/projection transformations
-        setLights(ourShader, pointLightPositions);
-        view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        // ------------- Objects -------------
-        drawIsland(ourShader, islandModel);
-        drawSnail(ourShader, snailModel);
-        drawTrees(ourShader, treeModel);
-        // Set cloud shader
-        instanceShader.use();
-        instanceShader.setMat4("projection", projection);
-        instanceShader.setMat4("view", view);
-        // Draw clouds
-        instanceShader.setInt("texture_diffuse", 0);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, cloudModel.textures_loaded[0].id); // note: we also made the textures_loaded vector public (instead of private) from the model class.
-        for (unsigned int i = 0; i < cloudModel.meshes.size(); i++) {
-            glBindVertexArray(cloudModel.meshes[i].VAO);
-            glDrawElementsInstanced(GL_TRIANGLES, cloudModel.meshes[i].indices.size(), GL_UNSIGNED_INT, 0, amount);
+        // this frame's render graph, only what the current settings need is allocated and run
+        // -----------------------------------------------------------------------------------
+        bool hdr = programState->hdr;
+        // bloom is only composited with HDR on and by the effects that tonemap (the kernel ones, 3 and up, don't),
+        // without it the bright parts don't need blurring at all
+        bool bloom = hdr && programState->bloom && programState->effectSelected < 3;
+        // without HDR (so without bloom too) and an effect the composite pass would only copy the scene
+        bool composite = hdr || programState->effectSelected != 0;
+        // a minimized window has no pixels, keep the targets valid anyway
+        int windowWidth = std::max(programState->screenWidth, 1);
+        int windowHeight = std::max(programState->screenHeight, 1);
+        float aspect = (float) windowWidth / (float) windowHeight;
+        dynamicResolution.SetTargetMilliseconds(programState->targetFrameMs);
+        if (programState->dynamicResolution)
+            dynamicResolution.Update();
+        float renderScale = programState->dynamicResolution ? dynamicResolution.Scale() : 1.0f;
+        int renderWidth = std::max((int) (windowWidth * renderScale + 0.5f), 1);
+        int renderHeight = std::max((int) (windowHeight * renderScale + 0.5f), 1);
+        depthPyramid.Resize(renderWidth, renderHeight);
+        mipChainBloom.Resize(renderWidth, renderHeight);
+        renderGraph.Reset();
+        RenderResource backbuffer = renderGraph.ImportBackbuffer(windowWidth, windowHeight);
+        // without HDR the scene fits in 8 bits per channel. The bright parts are only allocated when a blur reads them
+        GLenum sceneFormat = hdr ? GL_RGBA16F : GL_RGBA8;
+        RenderResource sceneColor = renderGraph.CreateTexture("scene color", {renderWidth, renderHeight, sceneFormat});
+        RenderResource brightColor = renderGraph.CreateTexture("bright color", {renderWidth, renderHeight, GL_RGBA16F});
+        RenderResource sceneDepth = renderGraph.CreateTexture("scene depth", {renderWidth, renderHeight, GL_DEPTH24_STENCIL8});
+
+        renderGraph.AddPass("scene", [&](const RenderGraph &graph) {
+            // draw in wireframe
+            if(programState->wireframe)
+                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            else
+                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+            // the graph bound the scene targets, draw the scene as we normally would
+            glEnable(GL_DEPTH_TEST);
+
+            // render
+            // ------
+            glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom), aspect, 0.1f, 100.0f);
+            glm::mat4 view = programState->camera.GetViewMatrix();
+            // view/projection transformations and lights for every program
+            camera.projection = projection;
+            camera.view = view;
+            camera.viewPosition = programState->camera.Position;
+            cameraBuffer.Update(camera);
+            setLights(lights, pointLightPositions);
+            lightsBuffer.Update(lights);
+
+            // Skybox shader set
+            glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+            skyboxShader.use();
+            // Draw skybox
+            glBindVertexArray(skyboxVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
             glBindVertexArray(0);
-        }
-        // -------------------------------------
-
+            glDepthFunc(GL_LESS); // set depth function back to default
+
+            // don't forget to enable shader before setting uniforms
+            ourShader.use();
+            ourShader.setBool("blinn", programState->blinnLighting);
+            ourShader.setFloat("material.shininess", 30.0f);
+
+            // ------------- Objects -------------
+            scene.SetTransform(islandObject, islandTransform());
+            scene.SetTransform(snailObject, snailTransform());
+            for (unsigned int i = 0; i < TREE_COUNT; i++)
+                scene.SetTransform(treeObjects[i], treeTransform(i));
+            scene.Draw(ourShader, batch, Frustum::FromMatrix(projection * view), programState->camera.Position);
+            programState->visibleMeshes = scene.VisibleMeshes();
+            programState->culledMeshes = scene.CulledMeshes();
+            for (unsigned int lod = 0; lod < MESH_MAX_LODS; lod++)
+                programState->lodMeshes[lod] = scene.LodMeshes(lod);
+            // the island and the trees hide a good part of the lower cloud layer, the clouds are culled against their depth.
+            // Wireframe leaves holes in the depth buffer, nothing would be occluded right
+            bool occlusionCulling = programState->occlusionCulling && !programState->wireframe;
+            if (occlusionCulling)
+                depthPyramid.Build(graph.Texture(sceneDepth), projection * view);
+            // Draw clouds
+            if (assets.IsReady(cloudModel)) {
+                Model &clouds = assets.GetModel(cloudModel);
+                // the draw below uses last frame's culling result, a wider field of view keeps clouds from popping in
+                // at the edges while turning
+                glm::mat4 cullProjection = glm::perspective(glm::radians(programState->camera.Zoom + CLOUD_CULL_FOV_MARGIN),
+                                                            aspect, 0.1f, 100.0f);
+                Frustum cullFrustum = Frustum::FromMatrix(cullProjection * view);
+                glm::vec4 cloudSphere = InstanceCuller::BoundingSphere(clouds);
+                cloudField.Update(programState->camera.Position);
+                cloudField.VisibleRanges(cullFrustum, cloudSphere, cloudRanges);
+                // the occlusion test lags the same frame, an instance's screen rectangle is grown by what turning by
+                // half the extra field of view moves things on screen
+                float occlusionMargin = std::tan(glm::radians(CLOUD_CULL_FOV_MARGIN * 0.5f)) /
+                                        std::tan(glm::radians(programState->camera.Zoom * 0.5f));
+                cloudCuller.Cull(cullFrustum, programState->camera.Position, cloudSphere, cloudRanges,
+                                 occlusionCulling ? &depthPyramid : nullptr, occlusionMargin);
+                // the meshes can be ready while the texture is still streaming in as the placeholder, the impostor
+                // is baked only once, from the real texture
+                unsigned int cloudTexture = clouds.textures_loaded[0].id;
+                if (!cloudImpostor.Baked() && !TextureRegistry::Instance().Loader().IsPending(cloudTexture))
+                    cloudImpostor.Bake(clouds, cloudTexture);
+
+                // Set cloud shader
+                instanceShader.use();
+                instanceShader.setInt("texture_diffuse", 0);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, clouds.textures_loaded[0].id); // note: we also made the textures_loaded vector public (instead of private) from the model class.
+                unsigned int read = cloudCuller.ReadBuffer();
+                for (unsigned int bucket = 0; bucket < CLOUD_IMPOSTOR_BUCKET; bucket++) {
+                    glBindVertexArray(cloudVAOs[bucket][read]);
+                    for (unsigned int i = 0; i < clouds.meshes.size(); i++) {
+                        const Mesh &mesh = clouds.meshes[i];
+                        const MeshLod &lod = mesh.Lod(bucket);
+                        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT, Mesh::IndexOffset(lod),
+                                                          cloudCuller.VisibleCount(bucket), mesh.baseVertex);
+                    }
+                }
+                glBindVertexArray(0);
+                cloudImpostor.Draw(cloudVAOs[CLOUD_IMPOSTOR_BUCKET][read], cloudCuller.VisibleCount(CLOUD_IMPOSTOR_BUCKET));
+                programState->visibleClouds = cloudCuller.VisibleCount();
+                for (unsigned int bucket = 0; bucket < cloudCuller.BucketCount(); bucket++)
+                    programState->lodClouds[bucket] = cloudCuller.VisibleCount(bucket);
+            }
+            // -------------------------------------
+
+
+            // Reset wireframe drawing so that it doesn't try to draw quads
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        }).Write(sceneColor).Write(brightColor).WriteDepth(sceneDepth);
 
-        // Reset wireframe drawing so that it doesn't try to draw quads
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        // both blurs are always declared, the composite pass only reads the selected one while bloom is on and the
+        // graph culls the rest (and the bright parts when nothing blurs them)
+        RenderResource mipChainBlur = renderGraph.ImportTexture("mip chain bloom", mipChainBloom.Texture());
+        renderGraph.AddPass("mip chain bloom", [&](const RenderGraph &graph) {
+            mipChainBloom.Render(graph.Texture(brightColor));
+        }).Read(brightColor).Write(mipChainBlur);
 
-        bool horizontal = true, first_iteration = true;
+        // a texture per pass, the graph lets them take turns in two textures (one of them the bright parts')
         unsigned int amount = 10;
-        blurShader.use();
+        RenderResource gaussianBlur = brightColor;
         for (unsigned int i = 0; i < amount; i++) {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-            blurShader.setInt("horizontal", horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);
-            renderQuad();
-            horizontal = !horizontal;
-            if (first_iteration)
-                first_iteration = false;
+            bool horizontal = i % 2 == 0;
+            RenderResource source = gaussianBlur;
+            gaussianBlur = renderGraph.CreateTexture("gaussian blur", {renderWidth, renderHeight, GL_RGBA16F});
+            renderGraph.AddPass("gaussian blur", [&, source, horizontal](const RenderGraph &graph) {
+                blurShader.use();
+                // the kernel only changes with the radius
+                if (programState->blurRadius != blurKernelRadius) {
+                    GaussianKernel kernel = GaussianKernel::Linear(programState->blurRadius);
+                    blurShader.setInt("tapCount", kernel.TapCount());
+                    glUniform1fv(blurShader.Location("offsets"), kernel.TapCount(), kernel.offsets.data());
+                    glUniform1fv(blurShader.Location("weights"), kernel.TapCount(), kernel.weights.data());
+                    blurKernelRadius = programState->blurRadius;
+                }
+                blurShader.setInt("horizontal", horizontal);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, graph.Texture(source));
+                renderQuad();
+            }).Read(source).Write(gaussianBlur);
+        }
+
+        RenderResource bloomBlur = 0;
+        float bloomStrength = 1.0f;
+        if (bloom) {
+            bloomBlur = programState->bloomMode == 0 ? mipChainBlur : gaussianBlur;
+            // the chain adds up a blur per level, keep the overall brightness of the single gaussian blur
+            if (programState->bloomMode == 0)
+                bloomStrength = 1.0f / mipChainBloom.MipCount();
+        }
+
+        if (composite) {
+            RenderGraph::PassBuilder compositePass = renderGraph.AddPass("composite", [&](const RenderGraph &graph) {
+                glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
+                // Clear all relevant buffers
+                glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessary actually, since we won't be able to see behind the quad anyways)
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                // Render the quad plane on default framebuffer, with the variant that only does what's selected. The
+                // kernel effects (3 and up) ignore HDR, settings that make no difference share a variant (bloom is
+                // already off for them and without HDR)
+                int effect = programState->effectSelected;
+                bool variantHdr = hdr && effect < 3;
+                int variant = effect * 4 + variantHdr * 2 + bloom;
+                if (variant != screenVariant) {
+                    screenShader = &screenShaders.Get({{"EFFECT", std::to_string(effect)},
+                                                       {"HDR", variantHdr ? "1" : "0"},
+                                                       {"BLOOM", bloom ? "1" : "0"}});
+                    screenShader->use();
+                    screenShader->setInt("screenTexture", 0);
+                    screenShader->setInt("bloomBlur", 1);
+                    screenVariant = variant;
+                }
+                screenShader->use();
+                screenShader->setFloat("bloomStrength", bloomStrength);
+                screenShader->setFloat("exposure", programState->hdrExposure);
+                screenShader->setFloat("gamma", programState->hdrGamma);
+                // Bind bloom and non bloom, both are filtered linearly so a scaled down scene is upsampled here
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, graph.Texture(sceneColor));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, graph.Texture(bloomBlur));
+                renderQuad();
+                glActiveTexture(GL_TEXTURE0);
+            });
+            compositePass.Read(sceneColor).Write(backbuffer);
+            if (bloomBlur)
+                compositePass.Read(bloomBlur);
+        }
+        else {
+            // nothing to tonemap, bloom or filter, copying the scene (stretched if it's scaled down) is all there is to do
+            renderGraph.AddPass("present", [&](const RenderGraph&) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, renderGraph.ReadFramebuffer(sceneColor));
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                GLenum filter = renderWidth == windowWidth && renderHeight == windowHeight ? GL_NEAREST : GL_LINEAR;
+                glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, filter);
+            }).Read(sceneColor).Write(backbuffer);
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // Bind back to default framebuffer and draw a quad plane with the attached framebuffer color texture
-        // glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
-        // Clear all relevant buffers
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessary actually, since we won't be able to see behind the quad anyways)
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Render the quad plane on default framebuffer
-        screenShader.use();
-        screenShader.setInt("bloom", programState->bloom);
-        screenShader.setInt("option", programState->effectSelected);
-        screenShader.setInt("hdr", programState->hdr);
-        screenShader.setFloat("exposure", programState->hdrExposure);
-        screenShader.setFloat("gamma", programState->hdrGamma);
-        // Bind bloom and non bloom
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
-
-        renderQuad();
-        //glBindVertexArray(quadVAO);
-        //glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-        //glDrawArrays(GL_TRIANGLES, 0, 6);
+        // the whole frame is timed, its cost is what the render scale trades against. Frames at full resolution while
+        // the scaling is off would only mislead it
+        if (programState->dynamicResolution)
+            dynamicResolution.Begin();
+        renderGraph.Execute();
+        if (programState->dynamicResolution)
+            dynamicResolution.End();
+        programState->renderScale = renderScale;
+        programState->gpuFrameMs = dynamicResolution.GpuMilliseconds();
+        programState->livePasses = renderGraph.LivePasses();
+        programState->declaredPasses = renderGraph.DeclaredPasses();
+        programState->renderTargets = renderGraph.AllocatedTextures();
+        programState->renderTargetBytes = renderGraph.AllocatedBytes();
 
         // Draw imgui
         if (programState->ImGuiEnabled)
@@ -624,12 +744,24 @@ int main() {
 
     glDeleteVertexArrays(1, &skyboxVAO);
     glDeleteBuffers(1, &skyboxVBO);
+    cameraBuffer.Delete();
+    lightsBuffer.Delete();
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVBO);
-    glDeleteBuffers(1, &framebuffer);
-    for(unsigned int i = 0; i < amount; i++){
-        glDeleteVertexArrays(1, &(cloudModel.meshes[i].VAO));
-    }
+    screenShaders.Delete();
+    renderGraph.Delete();
+    dynamicResolution.Delete();
+    depthPyramid.Delete();
+    mipChainBloom.Delete();
+    for (unsigned int bucket = 0; bucket < cloudCuller.BucketCount(); bucket++)
+        glDeleteVertexArrays(2, cloudVAOs[bucket]);
+    cloudImpostor.Delete();
+    cloudCuller.Delete();
+    cloudField.Delete();
+    batch.Delete();
+    assets.Clear();
+    MaterialTable::Instance().Clear();
+    GeometryArena::Instance().Clear();
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -637,55 +769,56 @@ int main() {
     return 0;
 }
 
-// Drawing functions
+// Scene placement
 // -------------------------
-void drawTrees(Shader modelShader, Model treeModel){
-    // Tree 1
+glm::mat4 treeTransform(unsigned int tree){
+    const glm::vec3 offsets[TREE_COUNT] = {
+            glm::vec3(8.0f, 1.0f, 4.0f),
+            glm::vec3(6.0f, 0.5f, -3.0f),
+            glm::vec3(-1.8f, 0.2f, 1.0f)
+    };
+    const float angles[TREE_COUNT] = {30.0f, 0.0f, AI_DEG_TO_RAD(220)};
+
     glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3((programState->islandPosition.x + 8.0f) * programState->islandScale,
-                                            (programState->islandPosition.y + 1.0f) * programState->islandScale,
-                                            (programState->islandPosition.z + 4.0f) * programState->islandScale));
+    model = glm::translate(model, (programState->islandPosition + offsets[tree]) * programState->islandScale);
     model = glm::scale(model, glm::vec3(programState->islandScale));
-    model = glm::rotate(model, 30.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-    modelShader.setMat4("model", model);
-    // Tree 2
-    treeModel.Draw(modelShader);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3((programState->islandPosition.x + 6.0f) * programState->islandScale,
-                                            (programState->islandPosition.y + 0.5f) * programState->islandScale,
-                                            (programState->islandPosition.z - 3.0f) * programState->islandScale));
-    model = glm::scale(model, glm::vec3(programState->islandScale));
-    model = glm::rotate(model, 0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-    modelShader.setMat4("model", model);
-    treeModel.Draw(modelShader);
-    //Tree 3
-    treeModel.Draw(modelShader);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3((programState->islandPosition.x - 1.8f) * programState->islandScale,
-                                            (programState->islandPosition.y + 0.2f) * programState->islandScale,
-                                            (programState->islandPosition.z + 1.0f) * programState->islandScale));
-    model = glm::scale(model, glm::vec3(programState->islandScale));
-    model = glm::rotate(model, AI_DEG_TO_RAD(220), glm::vec3(0.0f, 1.0f, 0.0f));
-    modelShader.setMat4("model", model);
-    treeModel.Draw(modelShader);
-
+    model = glm::rotate(model, angles[tree], glm::vec3(0.0f, 1.0f, 0.0f));
+    return model;
 }
-void drawSnail(Shader modelShader, Model snailModel){
+glm::mat4 snailTransform(){
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3((programState->islandPosition.x + 0.4f) * programState->islandScale,
                                             (programState->islandPosition.y + 0.6f) * programState->islandScale,
                                             (programState->islandPosition.z + 6.0f) * programState->islandScale)); // translate it down so it's at the center of the scene
     model = glm::scale(model, glm::vec3(programState->islandScale / 4));    // it's a bit too big for our scene, so scale it down
     model = glm::rotate(model, AI_DEG_TO_RAD(180), glm::vec3(0.2f, 1.0f, 1.0f));
-    modelShader.setMat4("model", model);
-    snailModel.Draw(modelShader);
+    return model;
 }
-void drawIsland(Shader modelShader, Model islandModel){
+glm::mat4 islandTransform(){
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, programState->islandPosition); // translate it down so it's at the center of the scene
     model = glm::scale(model, glm::vec3(programState->islandScale));    // it's a bit too big for our scene, so scale it down
-    modelShader.setMat4("model", model);
-    islandModel.Draw(modelShader);
+    return model;
+}
+// builds the VAO for the instanced clouds: the float vertex buffers of the geometry arena plus the CloudInstances
+// as instance vertex attributes (with divisor 1). Position/scale and rotation take locations 3 and 4, the clouds
+// don't need tangents and bitangents.
+// -----------------------------------------------------------------------------------------------------------------------------------
+unsigned int setupCloudInstancing(unsigned int instanceBuffer){
+    unsigned int VAO = GeometryArena::Instance().CreateVertexArray(VERTEX_FORMAT_FLOAT);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(CloudInstance), (void*)offsetof(CloudInstance, positionScale));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(CloudInstance), (void*)offsetof(CloudInstance, rotation));
+
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribDivisor(4, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return VAO;
 }
 // renderQuad() renders a 1x1 XY quad in NDC
 // -----------------------------------------
@@ -741,6 +874,9 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    // the render targets are sized from this every frame
+    if (programState)
+        programState->UpdateRatio(width, height);
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -787,9 +923,18 @@ void DrawImGui(ProgramState *programState) {
         ImGui::Checkbox("HDR", &programState->hdr);
         if(programState->hdr){
             ImGui::Checkbox("Bloom", &programState->bloom);
+            if (programState->bloom) {
+                ImGui::RadioButton("Mip chain bloom", &programState->bloomMode, 0);
+                ImGui::RadioButton("Gaussian bloom", &programState->bloomMode, 1);
+                if (programState->bloomMode == 1)
+                    ImGui::SliderInt("Blur radius", &programState->blurRadius, 1, GAUSSIAN_MAX_RADIUS);
+            }
             ImGui::SliderFloat("HDR Exposure", &programState->hdrExposure, 0.0f, 5.0f);
             ImGui::SliderFloat("HDR Gamma", &programState->hdrGamma, 0.0f, 5.0f);
         }
+        ImGui::Checkbox("Dynamic resolution", &programState->dynamicResolution);
+        if (programState->dynamicResolution)
+            ImGui::SliderFloat("Target GPU time (ms)", &programState->targetFrameMs, 4.0f, 33.0f);
         ImGui::Text("Effects");
         ImGui::Checkbox("Draw Wireframe", &programState->wireframe);
         ImGui::RadioButton("No Effect", &programState->effectSelected, 0);
@@ -810,6 +955,19 @@ void DrawImGui(ProgramState *programState) {
         ImGui::Text("(Yaw, Pitch): (%f, %f)", c.Yaw, c.Pitch);
         ImGui::Text("Camera front: (%f, %f, %f)", c.Front.x, c.Front.y, c.Front.z);
         ImGui::Checkbox("Camera mouse update", &programState->CameraMouseMovementUpdateEnabled);
+        ImGui::Checkbox("Cloud occlusion culling", &programState->occlusionCulling);
+        ImGui::Text("Meshes visible/culled: %u/%u", programState->visibleMeshes, programState->culledMeshes);
+        ImGui::Text("Mesh LODs 0/1/2: %u/%u/%u", programState->lodMeshes[0], programState->lodMeshes[1],
+                    programState->lodMeshes[2]);
+        ImGui::Text("Clouds visible: %u", programState->visibleClouds);
+        ImGui::Text("Clouds near/mid/impostor: %u/%u/%u", programState->lodClouds[0], programState->lodClouds[1],
+                    programState->lodClouds[2]);
+        ImGui::Text("Render passes run/declared: %u/%u", programState->livePasses, programState->declaredPasses);
+        ImGui::Text("Render targets: %u (%.1f MB)", programState->renderTargets,
+                    programState->renderTargetBytes / (1024.0 * 1024.0));
+        ImGui::Text("Render scale: %.2f (%dx%d), GPU %.2f ms", programState->renderScale,
+                    (int) (programState->screenWidth * programState->renderScale + 0.5f),
+                    (int) (programState->screenHeight * programState->renderScale + 0.5f), programState->gpuFrameMs);
         ImGui::End();
     }
 
@@ -865,82 +1023,20 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     }
 }
 
-unsigned int loadCubemap(vector<std::string> faces) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            // Load RGBA instead of RGB for .png cubemap textures
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                         0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data
-            );
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
+void setLights(LightsBlock &lights, glm::vec3 pointLightPositions[]) {
+    //directional light
+    lights.dirLight.direction = programState->dirLightDirection;
+    lights.dirLight.ambient = programState->dirLightAmbient;
+    lights.dirLight.diffuse = programState->dirLightDiffuse;
+    lights.dirLight.specular = programState->dirLightSpecular;
+    // point lights
+    for (unsigned int i = 0; i < POINT_LIGHT_COUNT; i++) {
+        lights.pointLights[i].position = pointLightPositions[i];
+        lights.pointLights[i].ambient = programState->pointLightAmbient;
+        lights.pointLights[i].diffuse = programState->pointLightDiffuse;
+        lights.pointLights[i].specular = programState->pointLightSpecular;
+        lights.pointLights[i].constant = programState->pointLight.constant;
+        lights.pointLights[i].linear = programState->pointLight.linear;
+        lights.pointLights[i].quadratic = programState->pointLight.quadratic;
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
 }
-
-void setLights(Shader lightingShader, glm::vec3 pointLightPositions[]) {
-    //directional light
-    lightingShader.setVec3("dirLight.direction", programState->dirLightDirection);
-    lightingShader.setVec3("dirLight.ambient", programState->dirLightAmbient);
-    lightingShader.setVec3("dirLight.diffuse", programState->dirLightDiffuse);
-    lightingShader.setVec3("dirLight.specular", programState->dirLightSpecular);
-    // point light 1
-    lightingShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-    lightingShader.setVec3("pointLights[0].ambient", programState->pointLightAmbient);
-    lightingShader.setVec3("pointLights[0].diffuse", programState->pointLightDiffuse);
-    lightingShader.setVec3("pointLights[0].specular", programState->pointLightSpecular);
-    lightingShader.setFloat("pointLights[0].constant", programState->pointLight.constant);
-    lightingShader.setFloat("pointLights[0].linear", programState->pointLight.linear);
-    lightingShader.setFloat("pointLights[0].quadratic", programState->pointLight.quadratic);
-    // point light 2
-    lightingShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-    lightingShader.setVec3("pointLights[1].ambient", programState->pointLightAmbient);
-    lightingShader.setVec3("pointLights[1].diffuse", programState->pointLightDiffuse);
-    lightingShader.setVec3("pointLights[1].specular", programState->pointLightSpecular);
-    lightingShader.setFloat("pointLights[1].constant", programState->pointLight.constant);
-    lightingShader.setFloat("pointLights[1].linear", programState->pointLight.linear);
-    lightingShader.setFloat("pointLights[1].quadratic", programState->pointLight.quadratic);
-    // point light 3
-    lightingShader.setVec3("pointLights[2].position", pointLightPositions[2]);
-    lightingShader.setVec3("pointLights[2].ambient", programState->pointLightAmbient);
-    lightingShader.setVec3("pointLights[2].diffuse", programState->pointLightDiffuse);
-    lightingShader.setVec3("pointLights[2].specular", programState->pointLightSpecular);
-    lightingShader.setFloat("pointLights[2].constant", programState->pointLight.constant);
-    lightingShader.setFloat("pointLights[2].linear", programState->pointLight.linear);
-    lightingShader.setFloat("pointLights[2].quadratic", programState->pointLight.quadratic);
-    // point light 4
-    lightingShader.setVec3("pointLights[3].position", pointLightPositions[3]);
-    lightingShader.setVec3("pointLights[3].ambient", programState->pointLightAmbient);
-    lightingShader.setVec3("pointLights[3].diffuse", programState->pointLightDiffuse);
-    lightingShader.setVec3("pointLights[3].specular", programState->pointLightSpecular);
-    lightingShader.setFloat("pointLights[3].constant", programState->pointLight.constant);
-    lightingShader.setFloat("pointLights[3].linear", programState->pointLight.linear);
-    lightingShader.setFloat("pointLights[3].quadratic", programState->pointLight.quadratic);
-    // point light 5
-    lightingShader.setVec3("pointLights[4].position", pointLightPositions[4]);
-    lightingShader.setVec3("pointLights[4].ambient", programState->pointLightAmbient);
-    lightingShader.setVec3("pointLights[4].diffuse", programState->pointLightDiffuse);
-    lightingShader.setVec3("pointLights[4].specular", programState->pointLightSpecular);
-    lightingShader.setFloat("pointLights[4].constant", programState->pointLight.constant);
-    lightingShader.setFloat("pointLights[4].linear", programState->pointLight.linear);
-    lightingShader.setFloat("pointLights[4].quadratic", programState->pointLight.quadratic);
-}
\ No newline at end of file
@@ -0,0 +1,156 @@
+// Checks that drawing a mesh allocates nothing once it has been drawn with a shader: Mesh::BindTextures and
+// Mesh::SetVertexDecode look their uniform locations up on the first draw with a shader and reuse them afterwards,
+// also when the mesh goes back and forth between shaders (depth pre-pass and lighting in the same frame).
+// Needs a display for the hidden window holding the GL context, run it from the project root.
+//
+// usage: mesh_bindings_test
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+// every allocation made through operator new, the test only looks at the difference around the draws
+static size_t allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+static const unsigned int STEADY_STATE_DRAWS = 1000;
+
+// a textured quad, the textures only have to exist for the binds
+static Mesh createMesh(unsigned int textureCount)
+{
+    std::vector<Vertex> vertices(4);
+    vertices[0].Position = glm::vec3(-1.0f, -1.0f, 0.0f);
+    vertices[1].Position = glm::vec3( 1.0f, -1.0f, 0.0f);
+    vertices[2].Position = glm::vec3( 1.0f,  1.0f, 0.0f);
+    vertices[3].Position = glm::vec3(-1.0f,  1.0f, 0.0f);
+    std::vector<unsigned int> indices = {0, 1, 2, 0, 2, 3};
+    std::vector<Texture> textures(textureCount);
+    for (unsigned int i = 0; i < textureCount; i++)
+    {
+        glGenTextures(1, &textures[i].id);
+        textures[i].type = i % 2 == 0 ? "texture_diffuse" : "texture_specular";
+    }
+    return Mesh(std::move(vertices), std::move(indices), std::move(textures));
+}
+
+int main()
+{
+    if (!glfwInit())
+    {
+        std::cout << "ERROR::TEST::Failed to initialize GLFW" << std::endl;
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    GLFWwindow *window = glfwCreateWindow(64, 64, "mesh_bindings_test", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "ERROR::TEST::Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress))
+    {
+        std::cout << "ERROR::TEST::Failed to initialize GLAD" << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    {
+        Shader lightingShader("resources/shaders/model_lighting_phong.vs", "resources/shaders/model_lighting_phong.fs");
+        Shader instanceShader("resources/shaders/instanceShader.vs", "resources/shaders/instanceShader.fs");
+        Mesh mesh = createMesh(4);
+
+        // the first draw with each shader fills the mesh's cache
+        mesh.BindTextures(lightingShader);
+        mesh.SetVertexDecode(lightingShader);
+        mesh.BindTextures(instanceShader);
+        mesh.SetVertexDecode(instanceShader);
+
+        size_t before = allocations;
+        for (unsigned int i = 0; i < STEADY_STATE_DRAWS; i++)
+        {
+            mesh.BindTextures(lightingShader);
+            mesh.SetVertexDecode(lightingShader);
+            mesh.BindTextures(instanceShader);
+            mesh.SetVertexDecode(instanceShader);
+        }
+        size_t allocated = allocations - before;
+        if (allocated != 0)
+        {
+            std::cout << "FAILED: " << allocated << " allocations in " << STEADY_STATE_DRAWS
+                      << " steady state draws with two shaders" << std::endl;
+            failures++;
+        }
+
+        // a new prefix means new sampler names, the next draw looks them up again and the one after doesn't
+        mesh.SetTextureNamePrefix("material.");
+        mesh.BindTextures(lightingShader);
+        before = allocations;
+        mesh.BindTextures(lightingShader);
+        mesh.SetVertexDecode(lightingShader);
+        allocated = allocations - before;
+        if (allocated != 0)
+        {
+            std::cout << "FAILED: " << allocated << " allocations drawing again after a new prefix" << std::endl;
+            failures++;
+        }
+
+        for (const Texture &texture : mesh.textures)
+            glDeleteTextures(1, &texture.id);
+        glDeleteProgram(lightingShader.ID);
+        glDeleteProgram(instanceShader.ID);
+    }
+    GeometryArena::Instance().Clear();
+
+    glfwTerminate();
+    if (failures == 0)
+        std::cout << "mesh_bindings_test: OK" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+// Offline texture baker: converts the PNG/JPG images under the given directories into pre-mipmapped,
+// block compressed DDS files (BC1 for opaque images, BC3 when there is alpha). Normal maps are baked like any
+// other image: no shader rebuilds z from two channels yet, so they stay three channel BC1.
+// The runtime (TextureLoader) picks up "<image>.dds" instead of decoding the source when it's up to date.
+//
+// usage: texture_baker [--force] [directory or image ...]     (defaults to resources/)
+
+#include <stb_image.h>
+#include <learnopengl/dds.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// RGBA8 image, one mip level
+struct Image {
+    uint32_t width;
+    uint32_t height;
+    std::vector<unsigned char> pixels;
+
+    const unsigned char* texel(uint32_t x, uint32_t y) const
+    {
+        // clamp so partial blocks on the right/bottom edge repeat the last row/column
+        x = std::min(x, width - 1);
+        y = std::min(y, height - 1);
+        return &pixels[(y * width + x) * 4];
+    }
+};
+
+// 2x2 box filter, odd sizes reuse the last row/column
+Image downsample(const Image &image)
+{
+    Image result;
+    result.width = image.width > 1 ? image.width / 2 : 1;
+    result.height = image.height > 1 ? image.height / 2 : 1;
+    result.pixels.resize(result.width * result.height * 4);
+    for (uint32_t y = 0; y < result.height; y++)
+        for (uint32_t x = 0; x < result.width; x++)
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = image.texel(2 * x, 2 * y)[c] + image.texel(2 * x + 1, 2 * y)[c]
+                          + image.texel(2 * x, 2 * y + 1)[c] + image.texel(2 * x + 1, 2 * y + 1)[c];
+                result.pixels[(y * result.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+    return result;
+}
+
+uint16_t packRGB565(const float color[3])
+{
+    int r = std::min(31, std::max(0, (int)(color[0] * 31.0f / 255.0f + 0.5f)));
+    int g = std::min(63, std::max(0, (int)(color[1] * 63.0f / 255.0f + 0.5f)));
+    int b = std::min(31, std::max(0, (int)(color[2] * 31.0f / 255.0f + 0.5f)));
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void unpackRGB565(uint16_t packed, float color[3])
+{
+    color[0] = (float)((packed >> 11) & 31) * 255.0f / 31.0f;
+    color[1] = (float)((packed >> 5) & 63) * 255.0f / 63.0f;
+    color[2] = (float)(packed & 31) * 255.0f / 31.0f;
+}
+
+// BC1 color block: endpoints are the extremes of the block along its principal axis, every texel then picks
+// the closest of the four palette entries. Always uses the 4 color mode (no 1 bit alpha).
+void encodeColorBlock(const unsigned char block[16][4], unsigned char *out)
+{
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += block[i][c] / 16.0f;
+
+    float covariance[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[3] = {block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2]};
+        covariance[0] += d[0] * d[0]; covariance[1] += d[0] * d[1]; covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1]; covariance[4] += d[1] * d[2]; covariance[5] += d[2] * d[2];
+    }
+    // a few power iterations are plenty to find the dominant direction
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+        };
+        float length = std::max(std::max(std::fabs(next[0]), std::fabs(next[1])), std::fabs(next[2]));
+        if (length < 1e-6f)
+            break;
+        for (int c = 0; c < 3; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float minProjection = 1e30f, maxProjection = -1e30f;
+    int minIndex = 0, maxIndex = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        float projection = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+        if (projection < minProjection) { minProjection = projection; minIndex = i; }
+        if (projection > maxProjection) { maxProjection = projection; maxIndex = i; }
+    }
+    float maxColor[3] = {(float)block[maxIndex][0], (float)block[maxIndex][1], (float)block[maxIndex][2]};
+    float minColor[3] = {(float)block[minIndex][0], (float)block[minIndex][1], (float)block[minIndex][2]};
+    uint16_t color0 = packRGB565(maxColor);
+    uint16_t color1 = packRGB565(minColor);
+    // the 4 color mode needs color0 > color1
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    float palette[4][3];
+    unpackRGB565(color0, palette[0]);
+    unpackRGB565(color1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            float bestDistance = 1e30f;
+            for (int p = 0; p < 4; p++)
+            {
+                float distance = 0;
+                for (int c = 0; c < 3; c++)
+                    distance += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+                if (distance < bestDistance) { bestDistance = distance; best = p; }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+    out[0] = color0 & 0xFF; out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF; out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// BC4 style single channel block (alpha of BC3), 8 interpolated values between min and max
+void encodeChannelBlock(const unsigned char block[16][4], int channel, unsigned char *out)
+{
+    int high = 0, low = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        high = std::max(high, (int)block[i][channel]);
+        low = std::min(low, (int)block[i][channel]);
+    }
+    out[0] = (unsigned char)high;
+    out[1] = (unsigned char)low;
+
+    float palette[8];
+    palette[0] = (float)high;
+    palette[1] = (float)low;
+    for (int p = 1; p < 7; p++)
+        palette[p + 1] = ((7 - p) * high + p * low) / 7.0f;
+
+    uint64_t indices = 0;
+    if (high != low)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            float bestDistance = 1e30f;
+            for (int p = 0; p < 8; p++)
+            {
+                float distance = std::fabs(block[i][channel] - palette[p]);
+                if (distance < bestDistance) { bestDistance = distance; best = p; }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+void compressLevel(const Image &image, DDSFormat format, std::vector<unsigned char> &out)
+{
+    unsigned char block[16][4];
+    for (uint32_t by = 0; by < image.height; by += 4)
+        for (uint32_t bx = 0; bx < image.width; bx += 4)
+        {
+            for (int i = 0; i < 16; i++)
+                memcpy(block[i], image.texel(bx + i % 4, by + i / 4), 4);
+
+            unsigned char encoded[16];
+            if (format == DDS_BC1)
+                encodeColorBlock(block, encoded);
+            else
+            {
+                encodeChannelBlock(block, 3, encoded);
+                encodeColorBlock(block, encoded + 8);
+            }
+            out.insert(out.end(), encoded, encoded + DDSBlockBytes(format));
+        }
+}
+
+bool hasExtension(const std::string &path, const char *extension)
+{
+    size_t length = strlen(extension);
+    if (path.size() < length)
+        return false;
+    for (size_t i = 0; i < length; i++)
+        if (tolower(path[path.size() - length + i]) != extension[i])
+            return false;
+    return true;
+}
+
+bool isSourceImage(const std::string &path)
+{
+    return hasExtension(path, ".png") || hasExtension(path, ".jpg") || hasExtension(path, ".jpeg");
+}
+
+bool bake(const std::string &path, bool force)
+{
+    std::string bakedPath = BakedTexturePath(path);
+    struct stat source, baked;
+    if (!force && stat(path.c_str(), &source) == 0 && stat(bakedPath.c_str(), &baked) == 0
+        && baked.st_mtime >= source.st_mtime)
+        return true;
+
+    int width, height, components;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, 4);
+    if (!data)
+    {
+        std::cout << "ERROR::TEXTURE_BAKER:: can't load " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+
+    DDSFormat format = DDS_BC1;
+    if (components == 4 || components == 2)
+    {
+        for (size_t i = 3; i < image.pixels.size(); i += 4)
+            if (image.pixels[i] != 255)
+            {
+                format = DDS_BC3;
+                break;
+            }
+    }
+
+    uint32_t mipCount = DDSFullMipCount(image.width, image.height);
+    std::vector<unsigned char> levels;
+    for (uint32_t level = 0; level < mipCount; level++)
+    {
+        compressLevel(image, format, levels);
+        if (level + 1 < mipCount)
+            image = downsample(image);
+    }
+
+    DDSHeader header;
+    memset(&header, 0, sizeof(header));
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.width = width;
+    header.height = height;
+    header.pitchOrLinearSize = DDSLevelSize(format, width, height);
+    header.mipMapCount = mipCount;
+    header.pixelFormat.size = sizeof(DDSPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    header.pixelFormat.fourCC = DDSFourCCFor(format);
+    header.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+    std::string tempPath = bakedPath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    out.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)levels.data(), levels.size());
+    out.close();
+    if (!out || std::rename(tempPath.c_str(), bakedPath.c_str()) != 0)
+    {
+        std::cout << "ERROR::TEXTURE_BAKER:: can't write " << bakedPath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    const char *formatNames[] = {"?", "BC1", "BC3", "BC5"};
+    size_t uncompressed = (size_t)width * height * 4 * 4 / 3;
+    std::cout << bakedPath << ": " << formatNames[format] << ", " << mipCount << " levels, "
+              << uncompressed / 1024 << " KB -> " << levels.size() / 1024 << " KB" << std::endl;
+    return true;
+}
+
+bool bakeTree(const std::string &path, bool force)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        std::cout << "ERROR::TEXTURE_BAKER:: " << path << " doesn't exist" << std::endl;
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode))
+        return !isSourceImage(path) || bake(path, force);
+
+    DIR *directory = opendir(path.c_str());
+    if (!directory)
+        return false;
+    std::vector<std::string> entries;
+    while (dirent *entry = readdir(directory))
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+            entries.push_back(path + '/' + entry->d_name);
+    closedir(directory);
+    std::sort(entries.begin(), entries.end());
+
+    bool success = true;
+    for (const std::string &entry : entries)
+        success = bakeTree(entry, force) && success;
+    return success;
+}
+
+int main(int argc, char **argv)
+{
+    // same orientation as the runtime, see stbi_set_flip_vertically_on_load in main.cpp
+    stbi_set_flip_vertically_on_load(false);
+
+    bool force = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--force") == 0)
+            force = true;
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+        paths.push_back("resources");
+
+    bool success = true;
+    for (const std::string &path : paths)
+        success = bakeTree(path, force) && success;
+    return success ? 0 : 1;
+}